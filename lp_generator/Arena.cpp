@@ -0,0 +1,36 @@
+#include "Arena.h"
+#include <cstdlib>
+
+using namespace std;
+
+static const size_t ARENA_BLOCK_SIZE = 1 << 20;
+
+Arena::Arena():cur_(NULL), left_(0) {}
+
+void *Arena::allocate(size_t bytes, size_t align) {
+    size_t pad = (align - (size_t)cur_ % align) % align;
+    if (cur_ == NULL || pad + bytes > left_) {
+        // start a new block, oversized requests get a block of their own
+        size_t size = bytes + align > ARENA_BLOCK_SIZE ? bytes + align : ARENA_BLOCK_SIZE;
+        char *block = (char *)malloc(size);
+        if (block == NULL) {
+            throw bad_alloc();
+        }
+        blocks_.push_back(block);
+        cur_ = block;
+        left_ = size;
+        pad = (align - (size_t)cur_ % align) % align;
+    }
+    void *mem = cur_ + pad;
+    cur_ += pad + bytes;
+    left_ -= pad + bytes;
+    return mem;
+}
+
+size_t Arena::getBytesReserved() { return blocks_.size() * ARENA_BLOCK_SIZE; }
+
+Arena::~Arena() {
+    for (char *block : blocks_) {
+        free(block);
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Bump allocator: memory is carved sequentially out of large blocks and is
+// only ever released all at once, when the arena itself is destroyed.
+// Objects placed in an arena never have their destructors run, so they must
+// not own memory from anywhere else (use ArenaVector for containers).
+class Arena {
+private:
+    vector<char *> blocks_;
+    char *cur_;   // next free byte of the current block
+    size_t left_; // bytes left in the current block
+    
+public:
+    Arena();
+    void *allocate(size_t bytes, size_t align);
+    size_t getBytesReserved();
+    ~Arena();
+    
+    // construct a T in the arena
+    template <class T, class... Args> T *create(Args &&... args) {
+        return new (allocate(sizeof(T), alignof(T))) T(forward<Args>(args)...);
+    }
+};
+
+// STL allocator drawing from an Arena, deallocation is a no-op
+template <class T> class ArenaAllocator {
+public:
+    typedef T value_type;
+    Arena *arena_;
+    
+    ArenaAllocator(Arena *arena):arena_(arena) {}
+    template <class U> ArenaAllocator(const ArenaAllocator<U> &other):arena_(other.arena_) {}
+    T *allocate(size_t n) { return (T *)arena_->allocate(n * sizeof(T), alignof(T)); }
+    void deallocate(T *, size_t) {}
+};
+
+template <class T, class U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena_ == b.arena_; }
+
+template <class T, class U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) { return a.arena_ != b.arena_; }
+
+template <class T> using ArenaVector = vector<T, ArenaAllocator<T>>;
+
+#endif
@@ -0,0 +1,318 @@
+#include "BranchAndBound.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+BranchAndBound::BranchAndBound(FlatKDG *flat):flat_(flat), hulls_(flat), prepared_(false),
+    nodeLimit_(0), timeLimit_(0), budget_(0), fixedCost_(0), fixedQuality_(0), best_(-INFINITY),
+    openBound_(-INFINITY), nodes_(0), stopped_(false) {}
+
+void BranchAndBound::setNodeLimit(uint64_t nodes) { nodeLimit_ = nodes; }
+
+void BranchAndBound::setTimeLimit(double seconds) { timeLimit_ = seconds; }
+
+uint64_t BranchAndBound::getNumNodes() { return nodes_; }
+
+bool BranchAndBound::isComplete() { return !stopped_; }
+
+// everything that does not depend on the budget
+void BranchAndBound::prepare() {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    unsigned num_knobs = flat_->getNumKnobs();
+    hulls_.build();
+    const unsigned *hull_begin = hulls_.getHullBegin();
+    const unsigned *hull = hulls_.getHull();
+    
+    // widest quality range first, those choices matter most
+    vector<float> spread(num_knobs, 0);
+    for (unsigned k = 0; k < num_knobs; k++) {
+        if (hull_begin[k] < hull_begin[k + 1]) {
+            spread[k] = quality[hull[hull_begin[k + 1] - 1]] - quality[hull[hull_begin[k]]];
+        }
+        order_.push_back(k);
+    }
+    stable_sort(order_.begin(), order_.end(), [&](unsigned a, unsigned b) { return spread[a] > spread[b]; });
+    
+    for (unsigned k = 0; k < num_knobs; k++) {
+        for (unsigned h = hull_begin[k] + 1; h < hull_begin[k + 1]; h++) {
+            double dc = (double)cost[hull[h]] - cost[hull[h - 1]], dq = (double)quality[hull[h]] - quality[hull[h - 1]];
+            segments_.push_back(Segment{dq / dc, dc, dq, k});
+        }
+    }
+    stable_sort(segments_.begin(), segments_.end(), [](const Segment &a, const Segment &b) {
+        return a.slope > b.slope;
+    });
+    
+    // rows, and the rows every basic node is a source of
+    sourceRowsBegin_.assign(flat_->getNumBasics() + 1, 0);
+    for (unsigned i = 0; i < flat_->getNumBasics(); i++) {
+        for (unsigned e = dep_begin[i]; e < dep_begin[i + 1];) {
+            unsigned end = e;
+            while (end < dep_begin[i + 1] && knob_of[dep_sources[end]] == knob_of[dep_sources[e]]) {
+                sourceRowsBegin_[dep_sources[end] + 1]++;
+                end++;
+            }
+            rows_.push_back(Row{i, e, end});
+            e = end;
+        }
+    }
+    for (unsigned i = 0; i < flat_->getNumBasics(); i++) {
+        sourceRowsBegin_[i + 1] += sourceRowsBegin_[i];
+    }
+    sourceRows_.resize(sourceRowsBegin_.back());
+    vector<unsigned> fill(sourceRowsBegin_.begin(), sourceRowsBegin_.end() - 1);
+    for (unsigned r = 0; r < rows_.size(); r++) {
+        for (unsigned e = rows_[r].begin; e < rows_[r].end; e++) {
+            sourceRows_[fill[dep_sources[e]]++] = r;
+        }
+    }
+    prepared_ = true;
+}
+
+bool BranchAndBound::forbid(unsigned basic) {
+    unsigned knob = flat_->getKnobOf()[basic];
+    trail_.push_back(basic);
+    if (forbidden_[basic]++ > 0) {
+        return true;
+    }
+    // all of the counts first, undo() takes back every one of them
+    knobForbidden_[knob]++;
+    for (unsigned r = sourceRowsBegin_[basic]; r < sourceRowsBegin_[basic + 1]; r++) {
+        rowAllowed_[sourceRows_[r]]--;
+    }
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    if (choice_[knob] == basic || knobForbidden_[knob] == knob_begin[knob + 1] - knob_begin[knob]) {
+        return false;
+    }
+    // sinks left without any source of a row go too
+    for (unsigned r = sourceRowsBegin_[basic]; r < sourceRowsBegin_[basic + 1]; r++) {
+        if (rowAllowed_[sourceRows_[r]] == 0 && !forbid(rows_[sourceRows_[r]].sink)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BranchAndBound::undo(size_t trail_mark) {
+    while (trail_.size() > trail_mark) {
+        unsigned basic = trail_.back();
+        trail_.pop_back();
+        if (--forbidden_[basic] == 0) {
+            knobForbidden_[flat_->getKnobOf()[basic]]--;
+            for (unsigned r = sourceRowsBegin_[basic]; r < sourceRowsBegin_[basic + 1]; r++) {
+                rowAllowed_[sourceRows_[r]]++;
+            }
+        }
+    }
+}
+
+// set knob to basic and forbid whatever that rules out; false on a conflict
+bool BranchAndBound::fix(unsigned knob, unsigned basic) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    choice_[knob] = basic;
+    
+    // the levels of every source knob outside the row
+    for (unsigned e = dep_begin[basic]; e < dep_begin[basic + 1];) {
+        unsigned source_knob = knob_of[dep_sources[e]];
+        unsigned end = e;
+        while (end < dep_begin[basic + 1] && knob_of[dep_sources[end]] == source_knob) {
+            end++;
+        }
+        for (unsigned i = knob_begin[source_knob]; i < knob_begin[source_knob + 1]; i++) {
+            if (!binary_search(dep_sources + e, dep_sources + end, i) && !forbid(i)) {
+                return false;
+            }
+        }
+        e = end;
+    }
+    // and the other levels of this knob
+    for (unsigned i = knob_begin[knob]; i < knob_begin[knob + 1]; i++) {
+        if (i != basic && !forbid(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Cheapest allowed hull point of every open knob, then the best steps up
+// while the budget lasts, the last one taken in part
+double BranchAndBound::getBound() {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const unsigned *hull_begin = hulls_.getHullBegin();
+    const unsigned *hull = hulls_.getHull();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    double base_cost = fixedCost_, value = fixedQuality_;
+    
+    // knobs narrowed down by forbidden levels get their own hull
+    vector<Segment> narrowed;
+    vector<unsigned> levels, own_hull;
+    for (unsigned k = 0; k < choice_.size(); k++) {
+        if (choice_[k] != NONE) {
+            continue;
+        }
+        if (knobForbidden_[k] == 0) {
+            base_cost += cost[hull[hull_begin[k]]];
+            value += quality[hull[hull_begin[k]]];
+            continue;
+        }
+        levels.clear();
+        for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+            if (forbidden_[i] == 0) {
+                levels.push_back(i);
+            }
+        }
+        ConvexHulls::buildHull(flat_, levels, own_hull);
+        base_cost += cost[own_hull[0]];
+        value += quality[own_hull[0]];
+        for (unsigned h = 1; h < own_hull.size(); h++) {
+            double dc = (double)cost[own_hull[h]] - cost[own_hull[h - 1]],
+                   dq = (double)quality[own_hull[h]] - quality[own_hull[h - 1]];
+            narrowed.push_back(Segment{dq / dc, dc, dq, k});
+        }
+    }
+    if (base_cost > budget_) {
+        return -INFINITY;
+    }
+    sort(narrowed.begin(), narrowed.end(), [](const Segment &a, const Segment &b) { return a.slope > b.slope; });
+    
+    // merge the shared steps of untouched knobs with the narrowed ones
+    double room = budget_ - base_cost;
+    unsigned s = 0, n = 0;
+    while (room > 0) {
+        const Segment *seg;
+        while (s < segments_.size() && (choice_[segments_[s].knob] != NONE || knobForbidden_[segments_[s].knob] > 0)) {
+            s++;
+        }
+        if (s < segments_.size() && (n == narrowed.size() || segments_[s].slope >= narrowed[n].slope)) {
+            seg = &segments_[s++];
+        } else if (n < narrowed.size()) {
+            seg = &narrowed[n++];
+        } else {
+            break;
+        }
+        if (seg->cost <= room) {
+            value += seg->quality;
+            room -= seg->cost;
+        } else {
+            value += seg->slope * room;
+            break;
+        }
+    }
+    return value;
+}
+
+void BranchAndBound::search(unsigned depth) {
+    if (depth == order_.size()) {
+        // the running sums went up and down all the way here, so take the
+        // leaf's own sums for the budget and the incumbent
+        double leaf_cost = 0, leaf_quality = 0;
+        for (unsigned i : choice_) {
+            leaf_cost += flat_->getCosts()[i];
+            leaf_quality += flat_->getQualities()[i];
+        }
+        if (leaf_cost <= budget_ && leaf_quality > best_ && Solution::meetsDependencies(flat_, choice_.data())) {
+            best_ = leaf_quality;
+            bestChoice_ = choice_;
+            LOG_DEBUG("bnb: " << best_ << " after " << nodes_ << " nodes");
+        }
+        return;
+    }
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    unsigned knob = order_[depth];
+    
+    // bound every allowed level, then go down the best bound first, so good
+    // configurations turn up early and the rest is cut off by them
+    vector<pair<double, unsigned> > children;
+    for (unsigned i = knob_begin[knob]; i < knob_begin[knob + 1]; i++) {
+        if (forbidden_[i] > 0) {
+            continue;
+        }
+        size_t mark = trail_.size();
+        fixedCost_ += cost[i];
+        fixedQuality_ += quality[i];
+        children.push_back(make_pair(fix(knob, i) ? getBound() : -INFINITY, i));
+        undo(mark);
+        choice_[knob] = NONE;
+        fixedCost_ -= cost[i];
+        fixedQuality_ -= quality[i];
+    }
+    sort(children.begin(), children.end(), [](const pair<double, unsigned> &a, const pair<double, unsigned> &b) {
+        return a.first > b.first;
+    });
+    
+    for (auto &child : children) {
+        if (child.first <= best_) {
+            break;
+        }
+        if (stopped_) {
+            // not explored: keep its bound for the gap
+            openBound_ = max(openBound_, child.first);
+            continue;
+        }
+        nodes_++;
+        if ((nodeLimit_ > 0 && nodes_ >= nodeLimit_) ||
+            (timeLimit_ > 0 && (nodes_ & 255) == 0 &&
+             chrono::duration<double>(chrono::steady_clock::now() - start_).count() > timeLimit_)) {
+            stopped_ = true;
+        }
+        unsigned i = child.second;
+        size_t mark = trail_.size();
+        fixedCost_ += cost[i];
+        fixedQuality_ += quality[i];
+        fix(knob, i);
+        search(depth + 1);
+        undo(mark);
+        choice_[knob] = NONE;
+        fixedCost_ -= cost[i];
+        fixedQuality_ -= quality[i];
+    }
+}
+
+bool BranchAndBound::solve(float budget, Solution &sol) {
+    if (!prepared_) {
+        prepare();
+    }
+    unsigned num_knobs = flat_->getNumKnobs();
+    budget_ = budget;
+    choice_.assign(num_knobs, NONE);
+    forbidden_.assign(flat_->getNumBasics(), 0);
+    knobForbidden_.assign(num_knobs, 0);
+    rowAllowed_.resize(rows_.size());
+    for (unsigned r = 0; r < rows_.size(); r++) {
+        rowAllowed_[r] = rows_[r].end - rows_[r].begin;
+    }
+    trail_.clear();
+    fixedCost_ = fixedQuality_ = 0;
+    best_ = openBound_ = -INFINITY;
+    bestChoice_.clear();
+    nodes_ = 0;
+    stopped_ = false;
+    start_ = chrono::steady_clock::now();
+    
+    double root_bound = getBound();
+    if (num_knobs == 0 || root_bound > -INFINITY) {
+        search(0);
+    }
+    
+    sol = Solution();
+    if (!bestChoice_.empty() || num_knobs == 0) {
+        sol.setChoice(flat_, bestChoice_);
+    }
+    // a finished search proves its best; a stopped one is only as good as
+    // the best it left out
+    sol.setBound(stopped_ ? max(best_, openBound_) : best_);
+    LOG_INFO("bnb: " << nodes_ << " nodes" << (stopped_ ? ", stopped at the limit" : "") << ", root bound " << root_bound);
+    return true;
+}
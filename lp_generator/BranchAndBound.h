@@ -0,0 +1,75 @@
+#ifndef BRANCHANDBOUND_H
+#define BRANCHANDBOUND_H
+
+#include "ConvexHulls.h"
+#include "FlatKDG.h"
+#include "Solution.h"
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// Exact depth first branch-and-bound for the one-level-per-knob model, for
+// graphs whose costs or dependency groups are too large for KnapsackDP.
+// Knobs are fixed one at a time, widest quality range first. Fixing a level
+// forbids the other levels of its knob and the levels of each source knob
+// that are not among its sources; a sink whose row loses its last source
+// is forbidden in turn. A knob left without levels, or a chosen level
+// forbidden later, closes the node. Nodes are bounded by the LP relaxation
+// of the knobs still open (see ConvexHulls), with the hulls of knobs
+// narrowed by forbidden levels rebuilt on the spot.
+// The search stops at the node or time limit; the solution then carries
+// the best bound of the parts left unexplored, hence the gap.
+class BranchAndBound {
+private:
+    struct Row { unsigned sink, begin, end; }; // a dependency row, see LpWriter
+    struct Segment { double slope, cost, quality; unsigned knob; };
+    
+    FlatKDG *flat_;
+    ConvexHulls hulls_;
+    bool prepared_;
+    uint64_t nodeLimit_;
+    double timeLimit_; // seconds
+    
+    vector<unsigned> order_;           // knobs in branching order
+    vector<Segment> segments_;         // hull steps of every knob, best slope first
+    vector<Row> rows_;
+    vector<unsigned> sourceRowsBegin_; // rows basic i is a source of
+    vector<unsigned> sourceRows_;
+    
+    // search state
+    float budget_;
+    vector<unsigned> choice_;          // per knob, NONE while open
+    vector<unsigned> forbidden_;       // per basic node, how many fixes rule it out
+    vector<unsigned> knobForbidden_;   // per knob, forbidden levels
+    vector<unsigned> rowAllowed_;      // per row, sources not forbidden
+    vector<unsigned> trail_;           // forbidden nodes, to undo
+    double fixedCost_;                 // of the knobs fixed so far, summed again at each leaf
+    double fixedQuality_;
+    double best_;
+    vector<unsigned> bestChoice_;
+    double openBound_;                 // best bound of what a stopped search left out
+    uint64_t nodes_;
+    bool stopped_;
+    chrono::steady_clock::time_point start_;
+    
+    void prepare();
+    bool forbid(unsigned basic);       // false if that breaks the current node
+    bool fix(unsigned knob, unsigned basic);
+    void undo(size_t trail_mark);
+    double getBound();                 // LP relaxation of the current node
+    void search(unsigned depth);
+    
+public:
+    static constexpr unsigned NONE = UINT32_MAX;
+    
+    BranchAndBound(FlatKDG *flat);
+    void setNodeLimit(uint64_t nodes);            // 0 for none
+    void setTimeLimit(double seconds);            // 0 for none
+    bool solve(float budget, Solution &sol);
+    uint64_t getNumNodes();
+    bool isComplete();                            // the last search ran to the end
+};
+
+#endif
@@ -0,0 +1,54 @@
+#include "ConvexHulls.h"
+#include <algorithm>
+
+using namespace std;
+
+ConvexHulls::ConvexHulls(FlatKDG *flat):flat_(flat) {}
+
+void ConvexHulls::buildHull(FlatKDG *flat, vector<unsigned> &levels, vector<unsigned> &hull) {
+    const float *cost = flat->getCosts();
+    const float *quality = flat->getQualities();
+    hull.clear();
+    sort(levels.begin(), levels.end(), [&](unsigned a, unsigned b) {
+        return cost[a] != cost[b] ? cost[a] < cost[b] : quality[a] > quality[b];
+    });
+    
+    // monotone chain over the levels that beat every cheaper one: a point
+    // goes when it lies under the line between its neighbours. Points on
+    // the line stay, so the greedy can stop halfway along it
+    for (unsigned i : levels) {
+        if (!hull.empty() && quality[i] <= quality[hull.back()]) {
+            continue;
+        }
+        while (hull.size() >= 2) {
+            unsigned a = hull[hull.size() - 2], b = hull.back();
+            double cross = (double)(cost[b] - cost[a]) * (quality[i] - quality[a]) -
+                           (double)(quality[b] - quality[a]) * (cost[i] - cost[a]);
+            if (cross <= 0) {
+                break;
+            }
+            hull.pop_back();
+        }
+        hull.push_back(i);
+    }
+}
+
+void ConvexHulls::build() {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    vector<unsigned> levels, hull;
+    hullBegin_.assign(1, 0);
+    hull_.clear();
+    for (unsigned k = 0; k < flat_->getNumKnobs(); k++) {
+        levels.clear();
+        for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+            levels.push_back(i);
+        }
+        buildHull(flat_, levels, hull);
+        hull_.insert(hull_.end(), hull.begin(), hull.end());
+        hullBegin_.push_back(hull_.size());
+    }
+}
+
+const unsigned *ConvexHulls::getHullBegin() { return hullBegin_.data(); }
+
+const unsigned *ConvexHulls::getHull() { return hull_.data(); }
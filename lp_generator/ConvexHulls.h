@@ -0,0 +1,32 @@
+#ifndef CONVEXHULLS_H
+#define CONVEXHULLS_H
+
+#include "FlatKDG.h"
+#include <vector>
+
+using namespace std;
+
+// Upper convex hull of the levels of every knob in the (cost, quality)
+// plane, cheapest first. Along a hull cost and quality both rise while the
+// quality gained per unit of cost never rises, so moving up a knob's hull
+// one step at a time, best step first over all knobs, gives the LP
+// relaxation of the one-level-per-knob model (dependencies left out).
+// Levels on a hull edge are kept as steps of their own. Built once per
+// graph and shared by the solvers.
+class ConvexHulls {
+private:
+    FlatKDG *flat_;
+    vector<unsigned> hullBegin_; // hull of knob k: hull_[hullBegin_[k] .. hullBegin_[k + 1])
+    vector<unsigned> hull_;      // basic nodes
+    
+public:
+    ConvexHulls(FlatKDG *flat);
+    void build();
+    const unsigned *getHullBegin();
+    const unsigned *getHull();
+    
+    // hull of a set of levels of one knob, as basic nodes; levels is reordered
+    static void buildHull(FlatKDG *flat, vector<unsigned> &levels, vector<unsigned> &hull);
+};
+
+#endif
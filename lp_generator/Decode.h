@@ -0,0 +1,30 @@
+#ifndef DECODE_H
+#define DECODE_H
+
+#include <cctype>
+#include <charconv>
+#include <cmath>
+
+using namespace std;
+
+// Locale independent, exception free number decoding straight off the input
+// text, with no temporary strings. Surrounding whitespace is allowed,
+// anything else (or an out of range value) makes the decode fail. Floats
+// take one optional sign and must be finite, nan and inf are no cost.
+inline bool decodeFloat(const char *p, const char *end, float &val) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    while (end > p && isspace((unsigned char)end[-1])) end--;
+    if (p < end && *p == '+') {
+        p++;
+        if (p < end && *p == '-') return false;
+    }
+    from_chars_result res = from_chars(p, end, val);
+    return res.ec == errc() && res.ptr == end && p < end && isfinite(val);
+}
+
+inline bool decodeUnsigned(const char *p, const char *end, unsigned long &val) {
+    from_chars_result res = from_chars(p, end, val);
+    return res.ec == errc() && res.ptr == end && p < end;
+}
+
+#endif
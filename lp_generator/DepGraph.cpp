@@ -0,0 +1,182 @@
+#include "DepGraph.h"
+#include "Log.h"
+#include <algorithm>
+
+using namespace std;
+
+DepGraph::DepGraph(FlatKDG *flat):flat_(flat), numRemovedEdges_(0) {}
+
+// iterative Tarjan, following the edges from sinks to their sources. A
+// component is complete only once everything it needs is, so components
+// come out sources first, which is the order we want.
+void DepGraph::sortTopological() {
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    unsigned num_basics = flat_->getNumBasics();
+    const unsigned NONE = UINT32_MAX;
+    vector<unsigned> index(num_basics, NONE), low(num_basics), next_edge(num_basics);
+    vector<char> on_stack(num_basics, 0);
+    vector<unsigned> stack, call, order;
+    unsigned counter = 0, num_cyclic = 0;
+    order.reserve(num_basics);
+    cycles_.clear();
+    
+    for (unsigned root = 0; root < num_basics; root++) {
+        if (index[root] != NONE) {
+            continue;
+        }
+        call.push_back(root);
+        while (!call.empty()) {
+            unsigned v = call.back();
+            if (index[v] == NONE) {
+                index[v] = low[v] = counter++;
+                next_edge[v] = dep_begin[v];
+                stack.push_back(v);
+                on_stack[v] = 1;
+            }
+            if (next_edge[v] < dep_begin[v + 1]) {
+                unsigned w = dep_sources[next_edge[v]++];
+                if (index[w] == NONE) {
+                    call.push_back(w);
+                } else if (on_stack[w]) {
+                    low[v] = min(low[v], index[w]);
+                }
+                continue;
+            }
+            
+            // all of v's sources are done
+            call.pop_back();
+            if (!call.empty()) {
+                low[call.back()] = min(low[call.back()], low[v]);
+            }
+            if (low[v] == index[v]) {
+                size_t first = order.size();
+                unsigned w;
+                do {
+                    w = stack.back();
+                    stack.pop_back();
+                    on_stack[w] = 0;
+                    order.push_back(w);
+                } while (w != v);
+                if (order.size() - first > 1) {
+                    cycles_.push_back(vector<unsigned>(order.begin() + first, order.end()));
+                    num_cyclic += order.size() - first;
+                }
+            }
+        }
+    }
+    flat_->setTopoOrder(order, num_cyclic);
+}
+
+// end of the row starting at edge e: the run of sources in the same knob
+unsigned DepGraph::getRowEnd(unsigned sink, unsigned e) {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    unsigned knob = knob_of[dep_sources[e]];
+    while (e < dep_begin[sink + 1] && knob_of[dep_sources[e]] == knob) {
+        e++;
+    }
+    return e;
+}
+
+// One level per knob is chosen, so a node of the row's knob settles it
+// outright. Otherwise node forces the row if one of its own rows does, on
+// the row's knob with a subset of its sources, or on another knob with every
+// source forcing it in turn. A node met again while being worked out (only
+// on a cycle) is taken as not forcing it, which can only keep rows.
+bool DepGraph::implies(unsigned node, unsigned knob) {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    if (knob_of[node] == knob) {
+        return inRow_[node];
+    }
+    if (state_[node] != UNSEEN) {
+        return state_[node] == YES;
+    }
+    state_[node] = BUSY;
+    touched_.push_back(node);
+    
+    bool forced = false;
+    for (unsigned e = dep_begin[node]; e < dep_begin[node + 1] && !forced;) {
+        unsigned end = getRowEnd(node, e);
+        if (keepEdge_[e]) {
+            forced = true;
+            for (unsigned f = e; f < end && forced; f++) {
+                forced = implies(dep_sources[f], knob);
+            }
+        }
+        e = end;
+    }
+    state_[node] = forced ? YES : NO;
+    return forced;
+}
+
+bool DepGraph::isImplied(unsigned sink, unsigned row_begin, unsigned row_end) {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    unsigned knob = knob_of[dep_sources[row_begin]];
+    for (unsigned e = row_begin; e < row_end; e++) {
+        inRow_[dep_sources[e]] = 1;
+    }
+    // on a cycle back to the sink, the row must not vouch for itself
+    state_[sink] = BUSY;
+    touched_.push_back(sink);
+    
+    bool implied = false;
+    for (unsigned e = dep_begin[sink]; e < dep_begin[sink + 1] && !implied;) {
+        unsigned end = getRowEnd(sink, e);
+        if (e != row_begin && keepEdge_[e]) {
+            implied = true;
+            for (unsigned f = e; f < end && implied; f++) {
+                implied = implies(dep_sources[f], knob);
+            }
+        }
+        e = end;
+    }
+    
+    for (unsigned e = row_begin; e < row_end; e++) {
+        inRow_[dep_sources[e]] = 0;
+    }
+    for (unsigned node : touched_) {
+        state_[node] = UNSEEN;
+    }
+    touched_.clear();
+    return implied;
+}
+
+// every row is checked against the rows still there, so dropping it never
+// changes which configurations are allowed
+void DepGraph::reduce() {
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *topo_order = flat_->getTopoOrder();
+    unsigned num_basics = flat_->getNumBasics();
+    unsigned num_edges = flat_->getNumEdges();
+    keepEdge_.assign(num_edges, 1);
+    inRow_.assign(num_basics, 0);
+    state_.assign(num_basics, UNSEEN);
+    
+    numRemovedEdges_ = 0;
+    for (unsigned t = 0; t < num_basics; t++) {
+        unsigned sink = topo_order[t];
+        for (unsigned e = dep_begin[sink]; e < dep_begin[sink + 1];) {
+            unsigned end = getRowEnd(sink, e);
+            if (isImplied(sink, e, end)) {
+                LOG_DEBUG("dependency row " << flat_->getBasicName(sink) << " <- "
+                          << flat_->getKnobName(flat_->getKnobOf()[flat_->getDepSources()[e]]) << " is implied");
+                fill(keepEdge_.begin() + e, keepEdge_.begin() + end, 0);
+                numRemovedEdges_ += end - e;
+            }
+            e = end;
+        }
+    }
+    if (numRemovedEdges_ > 0) {
+        flat_->pruneEdges(keepEdge_);
+    }
+}
+
+vector<vector<unsigned> > *DepGraph::getCycles() { return &cycles_; }
+
+unsigned DepGraph::getNumRemovedEdges() { return numRemovedEdges_; }
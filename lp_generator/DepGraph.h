@@ -0,0 +1,44 @@
+#ifndef DEPGRAPH_H
+#define DEPGRAPH_H
+
+#include "FlatKDG.h"
+#include <vector>
+
+using namespace std;
+
+// Passes over the dependency edges of a compiled KDG, run by KDG::freeze().
+// sortTopological() finds the strongly connected components (Tarjan) and
+// stores a topological order on the FlatKDG, sources before sinks; any
+// component with more than one node is a dependency cycle.
+// reduce() drops the dependency rows implied by the others. A row is the
+// set of sources a sink needs in one knob (see LpWriter); it is implied when
+// every source of another of the sink's rows already needs, directly or down
+// a chain of rows, one of its sources, e.g. the A.0 <- [C.0] of
+// A.0 <- [B.0], B.0 <- [C.0], A.0 <- [C.0].
+class DepGraph {
+private:
+    enum State { UNSEEN = 0, BUSY, YES, NO };
+    
+    FlatKDG *flat_;
+    vector<vector<unsigned> > cycles_;
+    vector<char> keepEdge_;
+    unsigned numRemovedEdges_;
+    
+    // per query state of implies()
+    vector<char> inRow_;
+    vector<char> state_;
+    vector<unsigned> touched_;
+    
+    bool implies(unsigned node, unsigned knob); // choosing node forces a source of the row being checked
+    bool isImplied(unsigned sink, unsigned row_begin, unsigned row_end);
+    unsigned getRowEnd(unsigned sink, unsigned e);
+    
+public:
+    DepGraph(FlatKDG *flat);
+    void sortTopological();
+    void reduce();
+    vector<vector<unsigned> > *getCycles();       // the nodes of every cycle found
+    unsigned getNumRemovedEdges();
+};
+
+#endif
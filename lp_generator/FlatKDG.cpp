@@ -0,0 +1,473 @@
+#include "FlatKDG.h"
+#include "DepGraph.h"
+#include "KDG.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+using namespace std;
+
+// Binary format, native byte order (the cache is host local):
+//   FlatHeader
+//   knobBegin, knobOf, cost, quality, depBegin, depSources, revDepBegin,
+//   revDepSinks, topoOrder, nameBegin, nameChars
+// every section starting on an 8 byte boundary, sizes following from the
+// counts in the header. Bump FLAT_VERSION whenever the layout (or what a
+// valid graph may hold) changes; version 3 has no knobs without levels,
+// version 4 records the source of cached graphs. load() checks every
+// offset and index before the graph is used, a stale or damaged file is
+// only a miss.
+static const char FLAT_MAGIC[8] = {'K', 'D', 'G', 'F', 'L', 'A', 'T', '\0'};
+static const uint32_t FLAT_VERSION = 4;
+static const uint32_t FLAT_BYTE_ORDER = 0x01020304;
+
+struct FlatHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t numKnobs;
+    uint32_t numBasics;
+    uint32_t numEdges;
+    uint32_t nameBytes;
+    uint32_t numCyclic;
+    uint32_t reserved;
+    uint64_t fileSize;
+    FlatSource source;
+};
+
+static_assert(sizeof(unsigned) == sizeof(uint32_t), "FlatKDG arrays are stored as 32 bit");
+static_assert(sizeof(FlatHeader) % 8 == 0, "sections start 8 byte aligned");
+
+static size_t align8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+FlatKDG::FlatKDG():numKnobs_(0), numBasics_(0), numEdges_(0), nameBytes_(0), numCyclic_(0) {
+    memset(&source_, 0, sizeof(source_));
+    pointAtOwn();
+}
+
+void FlatKDG::pointAtOwn() {
+    cost_ = ownCost_.data();
+    quality_ = ownQuality_.data();
+    knobBegin_ = ownKnobBegin_.data();
+    knobOf_ = ownKnobOf_.data();
+    depBegin_ = ownDepBegin_.data();
+    depSources_ = ownDepSources_.data();
+    revDepBegin_ = ownRevDepBegin_.data();
+    revDepSinks_ = ownRevDepSinks_.data();
+    topoOrder_ = ownTopoOrder_.data();
+    nameBegin_ = ownNameBegin_.data();
+    nameChars_ = ownNameChars_.data();
+}
+
+vector<pair<const void **, size_t> > FlatKDG::getSections() {
+    // counts widened first, so the header of a damaged file cannot wrap them
+    size_t u = sizeof(unsigned), f = sizeof(float);
+    size_t knobs = numKnobs_, basics = numBasics_, edges = numEdges_;
+    return {
+        {(const void **)&knobBegin_, (knobs + 1) * u},
+        {(const void **)&knobOf_, basics * u},
+        {(const void **)&cost_, basics * f},
+        {(const void **)&quality_, basics * f},
+        {(const void **)&depBegin_, (basics + 1) * u},
+        {(const void **)&depSources_, edges * u},
+        {(const void **)&revDepBegin_, (basics + 1) * u},
+        {(const void **)&revDepSinks_, edges * u},
+        {(const void **)&topoOrder_, basics * u},
+        {(const void **)&nameBegin_, (knobs + basics + 1) * u},
+        {(const void **)&nameChars_, (size_t)nameBytes_},
+    };
+}
+
+void FlatKDG::build(vector<Knob *> *knobs, vector<pair<Basic *, Basic *> > *edges) {
+    mapping_.close();
+    unsigned num_basics = 0;
+    knobs_.clear();
+    for (Knob *knob : *knobs) {
+        unsigned knob_basics = 0;
+        for (Level *lvl : *(knob->getLevelNodes())) {
+            knob_basics += lvl->getBasicNodes()->size();
+        }
+        // no level to choose, the knob stays out of every model
+        if (knob_basics > 0) {
+            knobs_.push_back(knob);
+            num_basics += knob_basics;
+        }
+    }
+    
+    ownCost_.clear();
+    ownQuality_.clear();
+    ownKnobBegin_.clear();
+    ownKnobOf_.clear();
+    ownNameBegin_.clear();
+    ownNameChars_.clear();
+    basics_.clear();
+    ownCost_.reserve(num_basics);
+    ownQuality_.reserve(num_basics);
+    ownKnobOf_.reserve(num_basics);
+    basics_.reserve(num_basics);
+    ownKnobBegin_.reserve(knobs_.size() + 1);
+    ownNameBegin_.reserve(knobs_.size() + num_basics + 1);
+    
+    for (unsigned k = 0; k < knobs_.size(); k++) {
+        ownKnobBegin_.push_back(basics_.size());
+        ownNameBegin_.push_back(ownNameChars_.size());
+        ownNameChars_.append(knobs_[k]->getName());
+        for (Level *lvl : *(knobs_[k]->getLevelNodes())) {
+            for (Basic *b : *(lvl->getBasicNodes())) {
+                b->setIndex(basics_.size());
+                ownCost_.push_back(b->getCost());
+                ownQuality_.push_back(b->getQuality());
+                ownKnobOf_.push_back(k);
+                basics_.push_back(b);
+            }
+        }
+    }
+    ownKnobBegin_.push_back(basics_.size());
+    for (Basic *b : basics_) {
+        ownNameBegin_.push_back(ownNameChars_.size());
+        ownNameChars_.append(b->getName());
+    }
+    ownNameBegin_.push_back(ownNameChars_.size());
+    
+    // dependency CSR: sort the (sink, source) index pairs, dropping duplicates
+    // and edges to nodes which never made it into the graph
+    vector<pair<unsigned, unsigned> > pairs;
+    pairs.reserve(edges->size());
+    for (auto &edge : *edges) {
+        unsigned sink = edge.first->getIndex(), source = edge.second->getIndex();
+        if (sink < basics_.size() && basics_[sink] == edge.first &&
+            source < basics_.size() && basics_[source] == edge.second) {
+            pairs.push_back(make_pair(sink, source));
+        }
+    }
+    sort(pairs.begin(), pairs.end());
+    pairs.erase(unique(pairs.begin(), pairs.end()), pairs.end());
+    
+    numKnobs_ = knobs_.size();
+    numBasics_ = num_basics;
+    buildDependencies(pairs);
+    nameBytes_ = ownNameChars_.size();
+    // placeholder until the dependencies are sorted, see DepGraph
+    ownTopoOrder_.resize(num_basics);
+    for (unsigned i = 0; i < num_basics; i++) {
+        ownTopoOrder_[i] = i;
+    }
+    numCyclic_ = 0;
+    pointAtOwn();
+}
+
+// dependency CSR from sorted, unique (sink, source) index pairs
+void FlatKDG::buildDependencies(vector<pair<unsigned, unsigned> > &pairs) {
+    ownDepBegin_.assign(numBasics_ + 1, 0);
+    ownRevDepBegin_.assign(numBasics_ + 1, 0);
+    ownDepSources_.resize(pairs.size());
+    ownRevDepSinks_.resize(pairs.size());
+    for (auto &p : pairs) {
+        ownDepBegin_[p.first + 1]++;
+        ownRevDepBegin_[p.second + 1]++;
+    }
+    for (unsigned i = 0; i < numBasics_; i++) {
+        ownDepBegin_[i + 1] += ownDepBegin_[i];
+        ownRevDepBegin_[i + 1] += ownRevDepBegin_[i];
+    }
+    // pairs are sorted by sink, so the forward rows fill in order; walking
+    // them in that order also leaves every reverse row sorted by sink
+    vector<unsigned> fill(ownRevDepBegin_.begin(), ownRevDepBegin_.end() - 1);
+    for (unsigned e = 0; e < pairs.size(); e++) {
+        ownDepSources_[e] = pairs[e].second;
+        ownRevDepSinks_[fill[pairs[e].second]++] = pairs[e].first;
+    }
+    
+    numEdges_ = pairs.size();
+    depBegin_ = ownDepBegin_.data();
+    depSources_ = ownDepSources_.data();
+    revDepBegin_ = ownRevDepBegin_.data();
+    revDepSinks_ = ownRevDepSinks_.data();
+}
+
+void FlatKDG::prune(const vector<char> &keep) {
+    // new index of every kept node
+    vector<unsigned> new_index(numBasics_, UINT32_MAX);
+    unsigned num_kept = 0;
+    for (unsigned i = 0; i < numBasics_; i++) {
+        if (keep[i]) {
+            new_index[i] = num_kept++;
+        }
+    }
+    
+    // everything is copied out of the current views before the storage
+    // they may point into gets replaced
+    vector<float> cost, quality;
+    vector<unsigned> knob_begin, knob_of, name_begin;
+    string name_chars;
+    vector<Basic *> basics;
+    cost.reserve(num_kept);
+    quality.reserve(num_kept);
+    knob_of.reserve(num_kept);
+    name_begin.reserve(numKnobs_ + num_kept + 1);
+    for (unsigned k = 0; k < numKnobs_; k++) {
+        knob_begin.push_back(cost.size());
+        name_begin.push_back(name_chars.size());
+        name_chars.append(getKnobName(k));
+        for (unsigned i = knobBegin_[k]; i < knobBegin_[k + 1]; i++) {
+            if (keep[i]) {
+                cost.push_back(cost_[i]);
+                quality.push_back(quality_[i]);
+                knob_of.push_back(k);
+            }
+        }
+    }
+    knob_begin.push_back(num_kept);
+    // dropped nodes get no index, kept ones their new one
+    for (unsigned i = 0; i < numBasics_; i++) {
+        if (i < basics_.size()) {
+            basics_[i]->setIndex(new_index[i]);
+        }
+        if (keep[i]) {
+            name_begin.push_back(name_chars.size());
+            name_chars.append(getBasicName(i));
+            if (i < basics_.size()) {
+                basics.push_back(basics_[i]);
+            }
+        }
+    }
+    name_begin.push_back(name_chars.size());
+    vector<pair<unsigned, unsigned> > pairs;
+    for (unsigned i = 0; i < numBasics_; i++) {
+        for (unsigned e = depBegin_[i]; keep[i] && e < depBegin_[i + 1]; e++) {
+            if (keep[depSources_[e]]) {
+                pairs.push_back(make_pair(new_index[i], new_index[depSources_[e]]));
+            }
+        }
+    }
+    
+    ownCost_ = move(cost);
+    ownQuality_ = move(quality);
+    ownKnobBegin_ = move(knob_begin);
+    ownKnobOf_ = move(knob_of);
+    ownNameBegin_ = move(name_begin);
+    ownNameChars_ = move(name_chars);
+    ownTopoOrder_.clear();
+    basics_ = move(basics);
+    mapping_.close();
+    numBasics_ = num_kept;
+    nameBytes_ = ownNameChars_.size();
+    buildDependencies(pairs);
+    pointAtOwn();
+    // a cycle may have lost the node closing it, so sort again rather than
+    // keep the old order and its count of cyclic nodes
+    DepGraph deps(this);
+    deps.sortTopological();
+}
+
+void FlatKDG::pruneEdges(const vector<char> &keep_edge) {
+    vector<pair<unsigned, unsigned> > pairs;
+    for (unsigned i = 0; i < numBasics_; i++) {
+        for (unsigned e = depBegin_[i]; e < depBegin_[i + 1]; e++) {
+            if (keep_edge[e]) {
+                pairs.push_back(make_pair(i, depSources_[e]));
+            }
+        }
+    }
+    // the other views may still point into a mapping, which stays open
+    buildDependencies(pairs);
+}
+
+void FlatKDG::setTopoOrder(vector<unsigned> &order, unsigned num_cyclic) {
+    ownTopoOrder_ = order;
+    topoOrder_ = ownTopoOrder_.data();
+    numCyclic_ = num_cyclic;
+}
+
+bool FlatKDG::save(string path) {
+    FlatHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC));
+    header.version = FLAT_VERSION;
+    header.byteOrder = FLAT_BYTE_ORDER;
+    header.numKnobs = numKnobs_;
+    header.numBasics = numBasics_;
+    header.numEdges = numEdges_;
+    header.nameBytes = nameBytes_;
+    header.numCyclic = numCyclic_;
+    header.source = source_;
+    header.fileSize = sizeof(header);
+    for (auto &section : getSections()) {
+        header.fileSize += align8(section.second);
+    }
+    
+    ofstream out(path, ios::binary | ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    static const char padding[8] = {0};
+    for (auto &section : getSections()) {
+        out.write((const char *)*section.first, section.second);
+        out.write(padding, align8(section.second) - section.second);
+    }
+    out.close();
+    return !out.fail();
+}
+
+bool FlatKDG::load(string path, const FlatSource *source) {
+    MappedFile mapping;
+    if (!mapping.open(path) || mapping.getSize() < sizeof(FlatHeader)) {
+        return false;
+    }
+    FlatHeader header;
+    memcpy(&header, mapping.getData(), sizeof(header));
+    if (memcmp(header.magic, FLAT_MAGIC, sizeof(FLAT_MAGIC)) != 0 ||
+        header.version != FLAT_VERSION || header.byteOrder != FLAT_BYTE_ORDER ||
+        header.fileSize != mapping.getSize()) {
+        return false;
+    }
+    if (source != NULL && (header.source.size != source->size ||
+                           header.source.hash[0] != source->hash[0] ||
+                           header.source.hash[1] != source->hash[1])) {
+        return false;
+    }
+    
+    numKnobs_ = header.numKnobs;
+    numBasics_ = header.numBasics;
+    numEdges_ = header.numEdges;
+    nameBytes_ = header.nameBytes;
+    numCyclic_ = header.numCyclic;
+    source_ = header.source;
+    size_t offset = sizeof(header);
+    for (auto &section : getSections()) {
+        offset += align8(section.second);
+    }
+    
+    // point every view into the mapping, which the FlatKDG then keeps
+    if (offset == header.fileSize) {
+        mapping_ = move(mapping);
+        offset = sizeof(header);
+        for (auto &section : getSections()) {
+            *section.first = mapping_.getData() + offset;
+            offset += align8(section.second);
+        }
+    }
+    if (offset != header.fileSize || !checkLoaded()) {
+        numKnobs_ = numBasics_ = numEdges_ = nameBytes_ = numCyclic_ = 0;
+        memset(&source_, 0, sizeof(source_));
+        mapping_.close();
+        pointAtOwn();
+        return false;
+    }
+    knobs_.clear();
+    basics_.clear();
+    return true;
+}
+
+bool FlatKDG::checkOffsets(const unsigned *begin, size_t count, size_t end) {
+    if (begin[0] != 0 || begin[count] != end) {
+        return false;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (begin[i] > begin[i + 1]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool FlatKDG::checkIndices(const unsigned *index, size_t count, size_t limit) {
+    for (size_t i = 0; i < count; i++) {
+        if (index[i] >= limit) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// everything the solvers and the writer index with, so a bad file cannot
+// send them out of bounds
+bool FlatKDG::checkLoaded() {
+    if (numCyclic_ > numBasics_ ||
+        !checkOffsets(knobBegin_, numKnobs_, numBasics_) ||
+        !checkOffsets(depBegin_, numBasics_, numEdges_) ||
+        !checkOffsets(revDepBegin_, numBasics_, numEdges_) ||
+        !checkOffsets(nameBegin_, (size_t)numKnobs_ + numBasics_, nameBytes_) ||
+        !checkIndices(depSources_, numEdges_, numBasics_) ||
+        !checkIndices(revDepSinks_, numEdges_, numBasics_) ||
+        !checkIndices(topoOrder_, numBasics_, numBasics_)) {
+        return false;
+    }
+    for (unsigned k = 0; k < numKnobs_; k++) {
+        if (knobBegin_[k] == knobBegin_[k + 1]) {
+            return false;
+        }
+        for (unsigned i = knobBegin_[k]; i < knobBegin_[k + 1]; i++) {
+            if (knobOf_[i] != k) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void FlatKDG::setSource(const FlatSource &source) { source_ = source; }
+
+// FNV-1a over the counts and the sections, byte by byte; the reverse rows
+// and the topological order only follow from the rest, but hashing them
+// too keeps this a plain walk over the sections
+uint64_t FlatKDG::getHash() {
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (uint64_t count : {numKnobs_, numBasics_, numEdges_, nameBytes_}) {
+        hash = (hash ^ count) * prime;
+    }
+    for (auto &section : getSections()) {
+        const unsigned char *bytes = (const unsigned char *)*section.first;
+        for (size_t i = 0; i < section.second; i++) {
+            hash = (hash ^ bytes[i]) * prime;
+        }
+    }
+    return hash;
+}
+
+unsigned FlatKDG::getNumKnobs() { return numKnobs_; }
+
+unsigned FlatKDG::getNumBasics() { return numBasics_; }
+
+const float *FlatKDG::getCosts() { return cost_; }
+
+const float *FlatKDG::getQualities() { return quality_; }
+
+const unsigned *FlatKDG::getKnobBegin() { return knobBegin_; }
+
+const unsigned *FlatKDG::getKnobOf() { return knobOf_; }
+
+Knob *FlatKDG::getKnob(unsigned k) { return k < knobs_.size() ? knobs_[k] : NULL; }
+
+Basic *FlatKDG::getBasic(unsigned idx) { return idx < basics_.size() ? basics_[idx] : NULL; }
+
+string_view FlatKDG::getKnobName(unsigned k) {
+    return string_view(nameChars_ + nameBegin_[k], nameBegin_[k + 1] - nameBegin_[k]);
+}
+
+string_view FlatKDG::getBasicName(unsigned idx) { return getKnobName(numKnobs_ + idx); }
+
+float FlatKDG::getMinCost() {
+    float sum = 0;
+    for (unsigned k = 0; k < numKnobs_; k++) {
+        float best = cost_[knobBegin_[k]];
+        for (unsigned i = knobBegin_[k] + 1; i < knobBegin_[k + 1]; i++) {
+            best = cost_[i] < best ? cost_[i] : best;
+        }
+        sum += best;
+    }
+    return sum;
+}
+
+unsigned FlatKDG::getNumEdges() { return numEdges_; }
+
+const unsigned *FlatKDG::getDepBegin() { return depBegin_; }
+
+const unsigned *FlatKDG::getDepSources() { return depSources_; }
+
+const unsigned *FlatKDG::getTopoOrder() { return topoOrder_; }
+
+unsigned FlatKDG::getNumCyclic() { return numCyclic_; }
+
+const unsigned *FlatKDG::getRevDepBegin() { return revDepBegin_; }
+
+const unsigned *FlatKDG::getRevDepSinks() { return revDepSinks_; }
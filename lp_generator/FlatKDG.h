@@ -0,0 +1,116 @@
+#ifndef FLATKDG_H
+#define FLATKDG_H
+
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+class Knob;
+class Basic;
+
+// What a cached graph was compiled from, the size and a 128 bit hash of the
+// input (see KDGCache::getKey); all zero for any other graph.
+struct FlatSource {
+    uint64_t size;
+    uint64_t hash[2];
+};
+
+// Compiled KDG - flat, contiguous per-graph arrays built by KDG::freeze().
+// Basic nodes are numbered knob by knob, level by level (one basic node per
+// level, see Level), so the basic nodes of knob k are the index range
+// [getKnobBegin()[k], getKnobBegin()[k + 1]), never empty: knobs without
+// any basic node are left out. Objective, budget and solver sweeps should
+// run over these arrays rather than the node objects.
+// Dependencies are kept in compressed sparse row form, both ways: the
+// sources of sink i are depSources[depBegin[i] .. depBegin[i + 1]) sorted by
+// index (hence grouped by knob), and the sinks of source j are
+// revDepSinks[revDepBegin[j] .. revDepBegin[j + 1]).
+// getTopoOrder() lists the basic nodes with every source before its sinks
+// (see DepGraph); nodes on dependency cycles are only grouped together.
+//
+// The arrays are views: into the FlatKDG's own storage once built, or
+// straight into a mapped binary file after load(), with no deserialization.
+// A loaded graph has no node objects behind it, getKnob/getBasic give NULL.
+class FlatKDG {
+private:
+    unsigned numKnobs_;
+    unsigned numBasics_;
+    unsigned numEdges_;
+    unsigned nameBytes_;
+    unsigned numCyclic_; // basic nodes on dependency cycles
+    FlatSource source_;
+    
+    // views
+    const float *cost_;
+    const float *quality_;
+    const unsigned *knobBegin_;   // numKnobs + 1 offsets into the arrays
+    const unsigned *knobOf_;      // owning knob of each basic node
+    const unsigned *depBegin_;    // numBasics + 1 offsets into depSources_
+    const unsigned *depSources_;
+    const unsigned *revDepBegin_; // numBasics + 1 offsets into revDepSinks_
+    const unsigned *revDepSinks_;
+    const unsigned *topoOrder_;   // numBasics entries
+    const unsigned *nameBegin_;   // knob names then basic names, offsets into nameChars_
+    const char *nameChars_;
+    
+    // storage of a built graph
+    vector<float> ownCost_;
+    vector<float> ownQuality_;
+    vector<unsigned> ownKnobBegin_;
+    vector<unsigned> ownKnobOf_;
+    vector<unsigned> ownDepBegin_;
+    vector<unsigned> ownDepSources_;
+    vector<unsigned> ownRevDepBegin_;
+    vector<unsigned> ownRevDepSinks_;
+    vector<unsigned> ownTopoOrder_;
+    vector<unsigned> ownNameBegin_;
+    string ownNameChars_;
+    vector<Knob *> knobs_;
+    vector<Basic *> basics_;
+    
+    // storage of a loaded graph
+    MappedFile mapping_;
+    
+    void pointAtOwn();
+    void buildDependencies(vector<pair<unsigned, unsigned> > &pairs);
+    vector<pair<const void **, size_t> > getSections(); // (view, bytes) in file order
+    bool checkOffsets(const unsigned *begin, size_t count, size_t end); // count + 1 offsets, ascending from 0 to end
+    bool checkIndices(const unsigned *index, size_t count, size_t limit); // every one below limit
+    bool checkLoaded();
+    
+public:
+    FlatKDG();
+    void build(vector<Knob *> *knobs, vector<pair<Basic *, Basic *> > *edges);
+    void prune(const vector<char> &keep);         // drop the basic nodes with keep[i] == 0 (their index becomes UINT32_MAX), renumbering the rest
+    void pruneEdges(const vector<char> &keep_edge); // drop the edges (depSources positions) with keep_edge[e] == 0
+    void setTopoOrder(vector<unsigned> &order, unsigned num_cyclic);
+    bool save(string path);                       // write the binary format, see FlatKDG.cpp
+    bool load(string path, const FlatSource *source = NULL); // map a file written by save(), compiled from source if given
+    void setSource(const FlatSource &source);     // stored by save()
+    uint64_t getHash();                           // of everything the models depend on, see ParetoTable
+    unsigned getNumKnobs();
+    unsigned getNumBasics();
+    const float *getCosts();
+    const float *getQualities();
+    const unsigned *getKnobBegin();
+    const unsigned *getKnobOf();
+    Knob *getKnob(unsigned k);
+    Basic *getBasic(unsigned idx);
+    string_view getKnobName(unsigned k);
+    string_view getBasicName(unsigned idx);
+    float getMinCost();                           // cheapest level of every knob, summed
+    unsigned getNumEdges();
+    const unsigned *getDepBegin();
+    const unsigned *getDepSources();
+    const unsigned *getRevDepBegin();
+    const unsigned *getRevDepSinks();
+    const unsigned *getTopoOrder();
+    unsigned getNumCyclic();
+};
+
+#endif
@@ -0,0 +1,380 @@
+#include "GreedySolver.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+GreedySolver::GreedySolver(FlatKDG *flat):flat_(flat), hulls_(flat), prepared_(false), hullCost_(0),
+    hullQuality_(0), baseCost_(INFINITY), baseQuality_(0), cost_(0), quality_(0) {}
+
+// everything that does not depend on the budget
+void GreedySolver::prepare() {
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    unsigned num_knobs = flat_->getNumKnobs();
+    hulls_.build();
+    const unsigned *hull_begin = hulls_.getHullBegin();
+    const unsigned *hull = hulls_.getHull();
+    
+    for (unsigned k = 0; k < num_knobs; k++) {
+        hullCost_ += cost[hull[hull_begin[k]]];
+        hullQuality_ += quality[hull[hull_begin[k]]];
+        for (unsigned h = hull_begin[k] + 1; h < hull_begin[k + 1]; h++) {
+            float dc = cost[hull[h]] - cost[hull[h - 1]], dq = quality[hull[h]] - quality[hull[h - 1]];
+            segments_.push_back(Segment{dq / dc, hull[h - 1], hull[h], k});
+        }
+    }
+    // stable, so the steps of a knob stay in hull order
+    stable_sort(segments_.begin(), segments_.end(), [](const Segment &a, const Segment &b) {
+        return a.slope > b.slope;
+    });
+    stepCost_.assign(1, 0);
+    stepQuality_.assign(1, 0);
+    for (Segment &seg : segments_) {
+        stepCost_.push_back(stepCost_.back() + cost[seg.to] - cost[seg.from]);
+        stepQuality_.push_back(stepQuality_.back() + quality[seg.to] - quality[seg.from]);
+    }
+    
+    if (!buildBase()) {
+        LOG_INFO("greedy: found no configuration meeting every dependency to start from");
+    }
+    LOG_INFO("greedy: " << segments_.size() << " hull steps, base cost " << baseCost_);
+    prepared_ = true;
+}
+
+// Cheapest level of every knob, then repairAll()
+bool GreedySolver::buildBase() {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *topo_order = flat_->getTopoOrder();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    unsigned num_knobs = flat_->getNumKnobs();
+    const unsigned *hull_begin = hulls_.getHullBegin();
+    const unsigned *hull = hulls_.getHull();
+    
+    vector<char> seen(num_knobs, 0);
+    for (unsigned n = flat_->getNumBasics(); n-- > 0;) {
+        unsigned k = knob_of[topo_order[n]];
+        if (!seen[k]) {
+            seen[k] = 1;
+            repairOrder_.push_back(k);
+        }
+    }
+    choice_.resize(num_knobs);
+    cost_ = quality_ = 0;
+    for (unsigned k = 0; k < num_knobs; k++) {
+        choice_[k] = hull[hull_begin[k]];
+        cost_ += cost[choice_[k]];
+        quality_ += quality[choice_[k]];
+    }
+    if (!repairAll()) {
+        return false;
+    }
+    base_ = choice_;
+    baseCost_ = cost_;
+    baseQuality_ = quality_;
+    return true;
+}
+
+// Repair passes over the working configuration, sinks before their
+// sources: a knob missing a source first tries to get it, and otherwise
+// moves to its cheapest level whose sources can be had. Repairs are moves,
+// so none breaks a sink that was met, and a pass that repairs nothing ends
+// the search.
+bool GreedySolver::repairAll() {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const float *cost = flat_->getCosts();
+    vector<unsigned> levels;
+    for (unsigned pass = 0; pass < MAX_REPAIR_PASSES; pass++) {
+        bool clean = true, progress = false;
+        for (unsigned k : repairOrder_) {
+            if (isMet(choice_[k])) {
+                continue;
+            }
+            clean = false;
+            changed_.clear();
+            if (move(k, choice_[k])) {
+                progress = true;
+                continue;
+            }
+            levels.clear();
+            for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+                levels.push_back(i);
+            }
+            sort(levels.begin(), levels.end(), [&](unsigned a, unsigned b) { return cost[a] < cost[b]; });
+            for (unsigned i : levels) {
+                if (i != choice_[k] && move(k, i)) {
+                    progress = true;
+                    break;
+                }
+            }
+        }
+        changed_.clear();
+        if (clean) {
+            return true;
+        }
+        if (!progress) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool GreedySolver::isMet(unsigned sink) {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    for (unsigned e = dep_begin[sink]; e < dep_begin[sink + 1];) {
+        unsigned knob = knob_of[dep_sources[e]];
+        bool met = false;
+        for (; e < dep_begin[sink + 1] && knob_of[dep_sources[e]] == knob; e++) {
+            met |= (dep_sources[e] == choice_[knob]);
+        }
+        if (!met) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void GreedySolver::setLevel(unsigned knob, unsigned level) {
+    if (choice_[knob] == level) {
+        return;
+    }
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    changed_.push_back(make_pair(knob, choice_[knob]));
+    cost_ += cost[level] - cost[choice_[knob]];
+    quality_ += quality[level] - quality[choice_[knob]];
+    choice_[knob] = level;
+}
+
+void GreedySolver::rollback(size_t mark) {
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    while (changed_.size() > mark) {
+        unsigned knob = changed_.back().first, level = changed_.back().second;
+        changed_.pop_back();
+        cost_ += cost[level] - cost[choice_[knob]];
+        quality_ += quality[level] - quality[choice_[knob]];
+        choice_[knob] = level;
+    }
+}
+
+// pick a source for every row of level left unmet, one whose own rows are
+// met already if there is any, the cheapest otherwise; then go on with the
+// rows of that source
+bool GreedySolver::repair(unsigned level, unsigned depth) {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    for (unsigned e = dep_begin[level]; e < dep_begin[level + 1];) {
+        unsigned knob = knob_of[dep_sources[e]];
+        unsigned row_end = e;
+        bool met = false;
+        while (row_end < dep_begin[level + 1] && knob_of[dep_sources[row_end]] == knob) {
+            met |= (dep_sources[row_end++] == choice_[knob]);
+        }
+        if (met) {
+            e = row_end;
+            continue;
+        }
+        unsigned cheapest = dep_sources[e];
+        bool cheapest_met = isMet(cheapest);
+        for (e++; e < row_end; e++) {
+            unsigned i = dep_sources[e];
+            bool i_met = isMet(i);
+            if (i_met != cheapest_met ? i_met :
+                (cost[i] < cost[cheapest] || (cost[i] == cost[cheapest] && quality[i] > quality[cheapest]))) {
+                cheapest = i;
+                cheapest_met = i_met;
+            }
+        }
+        if (depth == MAX_REPAIR_DEPTH) {
+            return false;
+        }
+        setLevel(knob, cheapest);
+        if (!repair(cheapest, depth + 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// A broken row has its sink or its source among the changed knobs. Sinks
+// that were chosen before all had the level their source knob had then.
+// broken is the chosen sink that lost a source, NONE if a changed knob
+// lost its own.
+bool GreedySolver::checkChanged(size_t mark, unsigned &broken) {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *rev_begin = flat_->getRevDepBegin();
+    const unsigned *rev_sinks = flat_->getRevDepSinks();
+    for (size_t c = mark; c < changed_.size(); c++) {
+        unsigned knob = changed_[c].first, before = changed_[c].second;
+        if (!isMet(choice_[knob])) {
+            broken = NONE;
+            return false;
+        }
+        for (unsigned e = rev_begin[before]; e < rev_begin[before + 1]; e++) {
+            unsigned sink = rev_sinks[e];
+            if (choice_[knob_of[sink]] == sink && !isMet(sink)) {
+                broken = sink;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// The level and its missing sources, then the sinks this leaves without a
+// source move to their best level that still has all of its own. Rolled
+// back if that fails.
+bool GreedySolver::move(unsigned knob, unsigned level) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const unsigned *knob_of = flat_->getKnobOf();
+    const float *quality = flat_->getQualities();
+    size_t mark = changed_.size();
+    setLevel(knob, level);
+    bool ok = repair(level, 0);
+    for (unsigned fixes = 0, broken; ok && !checkChanged(mark, broken); fixes++) {
+        if (broken == NONE || fixes == MAX_REPAIR_DEPTH) {
+            ok = false;
+            break;
+        }
+        unsigned sink_knob = knob_of[broken], best = NONE;
+        for (unsigned i = knob_begin[sink_knob]; i < knob_begin[sink_knob + 1]; i++) {
+            if (isMet(i) && (best == NONE || quality[i] > quality[best])) {
+                best = i;
+            }
+        }
+        if (best == NONE) {
+            ok = false;
+            break;
+        }
+        setLevel(sink_knob, best);
+    }
+    // knob itself is not among the changes if it kept its level
+    if (ok && isMet(choice_[knob])) {
+        return true;
+    }
+    rollback(mark);
+    return false;
+}
+
+// move(), kept only if within budget and better on the whole
+bool GreedySolver::tryMove(unsigned knob, unsigned level, float budget) {
+    size_t mark = changed_.size();
+    double quality_before = quality_;
+    if (!move(knob, level)) {
+        return false;
+    }
+    if (cost_ <= budget && quality_ > quality_before) {
+        return true;
+    }
+    rollback(mark);
+    return false;
+}
+
+bool GreedySolver::solve(float budget, Solution &sol) {
+    if (!prepared_) {
+        prepare();
+    }
+    sol = Solution();
+    if (baseCost_ > budget) {
+        sol.setBound(getBound(budget));
+        return true;
+    }
+    climb(base_, baseCost_, baseQuality_, budget, sol);
+    return true;
+}
+
+bool GreedySolver::solveFrom(const vector<unsigned> &start, float budget, Solution &sol) {
+    if (!prepared_) {
+        prepare();
+    }
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    if (start.size() != flat_->getNumKnobs()) {
+        return false;
+    }
+    choice_ = start;
+    cost_ = quality_ = 0;
+    for (unsigned i : start) {
+        cost_ += cost[i];
+        quality_ += quality[i];
+    }
+    if ((!Solution::meetsDependencies(flat_, choice_.data()) && !repairAll()) || cost_ > budget) {
+        return false;
+    }
+    vector<unsigned> repaired = choice_;
+    climb(repaired, cost_, quality_, budget, sol);
+    return true;
+}
+
+void GreedySolver::climb(const vector<unsigned> &start, double start_cost, double start_quality, float budget,
+                         Solution &sol) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    choice_ = start;
+    cost_ = start_cost;
+    quality_ = start_quality;
+    for (Segment &seg : segments_) {
+        unsigned current = choice_[seg.knob];
+        if (quality[seg.to] > quality[current] && cost_ + cost[seg.to] - cost[current] <= budget) {
+            changed_.clear();
+            tryMove(seg.knob, seg.to, budget);
+        }
+    }
+    
+    // then whatever budget the steps left, on any level that fits, off the
+    // hulls too; best quality first
+    vector<unsigned> levels;
+    for (unsigned k = 0; k < flat_->getNumKnobs(); k++) {
+        levels.clear();
+        for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+            if (quality[i] > quality[choice_[k]] && cost_ + cost[i] - cost[choice_[k]] <= budget) {
+                levels.push_back(i);
+            }
+        }
+        sort(levels.begin(), levels.end(), [&](unsigned a, unsigned b) { return quality[a] > quality[b]; });
+        for (unsigned i : levels) {
+            changed_.clear();
+            if (tryMove(k, i, budget)) {
+                break;
+            }
+        }
+    }
+    changed_.clear();
+    sol = Solution();
+    sol.setChoice(flat_, choice_);
+    sol.setBound(getBound(budget));
+}
+
+// cheapest hull points, then whole steps while their running cost fits,
+// then the part of the next one that does
+float GreedySolver::getBound(float budget) {
+    if (!prepared_) {
+        prepare();
+    }
+    double room = budget - hullCost_;
+    if (room < 0) {
+        return -INFINITY;
+    }
+    size_t n = upper_bound(stepCost_.begin(), stepCost_.end(), room) - stepCost_.begin() - 1;
+    double value = hullQuality_ + stepQuality_[n];
+    if (n < segments_.size()) {
+        value += segments_[n].slope * (room - stepCost_[n]);
+    }
+    return value;
+}
+
+float GreedySolver::getBaseCost() {
+    if (!prepared_) {
+        prepare();
+    }
+    return baseCost_;
+}
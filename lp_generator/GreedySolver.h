@@ -0,0 +1,75 @@
+#ifndef GREEDYSOLVER_H
+#define GREEDYSOLVER_H
+
+#include "ConvexHulls.h"
+#include "FlatKDG.h"
+#include "Solution.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// Fast heuristic for runtime reconfiguration: no search, a single pass over
+// the hull steps of every knob (see ConvexHulls), best quality per unit of
+// cost first, taking each step the budget still allows. A step whose level
+// needs sources not chosen also moves those source knobs to their cheapest
+// level in the row, and a chosen sink left without its source moves to its
+// best level that has them, a few dependencies deep either way. A step is
+// skipped when that fails or loses quality overall. What budget is left
+// at the end goes to the best level of each knob that still fits, on the
+// hull or not, the same way.
+// Everything that does not depend on the budget is done once, on the first
+// solve: the hulls, the steps in order, their running sums (the LP bound
+// of any budget is then a binary search) and a cheap configuration that
+// meets every dependency to climb from. Each solve after that costs one
+// walk over the steps and one over the levels, so keep the solver around
+// and call it per budget.
+class GreedySolver {
+private:
+    struct Segment { float slope; unsigned from, to, knob; };
+    
+    FlatKDG *flat_;
+    ConvexHulls hulls_;
+    bool prepared_;
+    vector<Segment> segments_;         // hull steps of every knob, best slope first
+    vector<double> stepCost_;          // running sums over segments_, from 0
+    vector<double> stepQuality_;
+    double hullCost_;                  // cheapest hull point of every knob, summed
+    double hullQuality_;
+    vector<unsigned> repairOrder_;     // knobs, sinks before their sources
+    vector<unsigned> base_;            // the configuration climbed from, empty if none was found
+    double baseCost_;
+    double baseQuality_;
+    
+    // working configuration
+    vector<unsigned> choice_;
+    double cost_;
+    double quality_;
+    vector<pair<unsigned, unsigned> > changed_; // (knob, level before), to roll back
+    
+    void prepare();
+    bool buildBase();
+    bool repairAll();                  // make the working configuration meet every dependency
+    bool isMet(unsigned sink);         // every row of sink has its chosen source
+    void setLevel(unsigned knob, unsigned level);
+    bool repair(unsigned level, unsigned depth); // choose the missing sources of level
+    bool checkChanged(size_t mark, unsigned &broken); // dependencies around the knobs changed since mark
+    void rollback(size_t mark);
+    bool move(unsigned knob, unsigned level);   // level with what it needs, false and rolled back if that fails
+    bool tryMove(unsigned knob, unsigned level, float budget);
+    void climb(const vector<unsigned> &start, double start_cost, double start_quality, float budget, Solution &sol);
+    
+public:
+    static constexpr unsigned NONE = UINT32_MAX;
+    static const unsigned MAX_REPAIR_DEPTH = 4;
+    static const unsigned MAX_REPAIR_PASSES = 16;
+    
+    GreedySolver(FlatKDG *flat);
+    bool solve(float budget, Solution &sol);     // sol is left empty if nothing fits
+    bool solveFrom(const vector<unsigned> &start, float budget, Solution &sol); // climb from start instead, repaired first if need be; false if that fails
+    float getBound(float budget);                 // LP relaxation, dependencies left out
+    float getBaseCost();                          // cheapest configuration found, INFINITY if none
+};
+
+#endif
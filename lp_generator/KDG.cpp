@@ -1,21 +1,32 @@
 #include "KDG.h"
-#include <iostream>
+#include "DepGraph.h"
+#include "Log.h"
 
 using namespace std;
 
 /****** Node ******/
 
-void Node::setName(string n) { name_ = n; }
+Node::Node(KDG *graph):graph_(graph), nameId_(0) {}
 
-string Node::getName() { return name_; }
+void Node::setName(string_view n) { nameId_ = graph_->getNames()->intern(n); }
+
+string_view Node::getName() { return graph_->getNames()->getName(nameId_); }
+
+uint32_t Node::getNameId() { return nameId_; }
+
+KDG *Node::getGraph() { return graph_; }
 
 
 /****** Basic ******/
 
-Basic::Basic(string basicName):cost_(0.0), quality_(0.0) {
+Basic::Basic(KDG *graph, string_view basicName):Node(graph), cost_(0.0), quality_(0.0), index_(0) {
     setName(basicName);
 }
 
+unsigned Basic::getIndex() { return index_; }
+
+void Basic::setIndex(unsigned idx) { index_ = idx; }
+
 void Basic::setCost(float val) { cost_ = val; }
 
 void Basic::setQuality(float val) { quality_ = val; }
@@ -24,73 +35,147 @@ float Basic::getCost() { return cost_; }
 
 float Basic::getQuality() { return quality_; }
 
-void Basic::addDependency(Basic * source) { dependencies_.push_back(source); }
+void Basic::addDependency(Basic * source) { getGraph()->addDependency(this, source); }
 
 /****** Level ******/
 
 
-Level::Level(int lvl):level_(lvl) {}
+Level::Level(KDG *graph, int lvl):Node(graph), level_(lvl),
+    basicNodes_(ArenaAllocator<Basic *>(graph->getArena())) {}
 
-vector<Basic *> *Level::getBasicNodes() { return &basicNodes_; }
+ArenaVector<Basic *> *Level::getBasicNodes() { return &basicNodes_; }
 
 void Level::addBasicNode(Basic *basic) { basicNodes_.push_back(basic); }
 
 int Level::getLevelNum() { return level_; }
 
-Level::~Level() {
-    for (Basic *basic : basicNodes_) {
-        delete basic;
-    }
-}
-
 
 /****** Knob ******/
 
-Knob::Knob(string knob_name){
+Knob::Knob(KDG *graph, string_view knob_name):Node(graph),
+    levelNodes_(ArenaAllocator<Level *>(graph->getArena())) {
     setName(knob_name);
 }
 
-vector<Level *> *Knob::getLevelNodes() { return &levelNodes_; }
+ArenaVector<Level *> *Knob::getLevelNodes() { return &levelNodes_; }
 
 void Knob::addLevelNode(Level *level) { levelNodes_.push_back(level); }
 
-Knob::~Knob() {
-    for (Level *level : levelNodes_) {
-        delete level;
-    }
-}
-
 
 /****** KDG ******/
 
-KDG::KDG(string appName):appName_(appName) {}
+KDG::KDG(string appName):appName_(appName), frozen_(false) {}
 
-void KDG::addKnob(Knob *knob) {
+Knob *KDG::newKnob(string_view name) { return arena_.create<Knob>(this, name); }
+
+Level *KDG::newLevel(int lvl) { return arena_.create<Level>(this, lvl); }
+
+Basic *KDG::newBasic(string_view name) { return arena_.create<Basic>(this, name); }
+
+Arena *KDG::getArena() { return &arena_; }
+
+NameTable *KDG::getNames() { return &names_; }
+
+bool KDG::addKnob(Knob *knob) {
+    if (frozen_) {
+        LOG_ERROR("KDG " << appName_ << " is frozen, cannot add knob " << knob->getName());
+        return false;
+    }
     knobs_.push_back(knob);
+    
+    // index the knob and everything below it, first name wins on clashes.
+    // Name ids are dense, so the indexes are plain vectors sized to the table.
+    knobIndex_.resize(names_.getSize(), NULL);
+    basicIndex_.resize(names_.getSize(), NULL);
+    if (knobIndex_[knob->getNameId()] == NULL) {
+        knobIndex_[knob->getNameId()] = knob;
+    }
+    for (Level *lvl : *(knob->getLevelNodes())) {
+        for (Basic *b : *(lvl->getBasicNodes())) {
+            if (basicIndex_[b->getNameId()] == NULL) {
+                basicIndex_[b->getNameId()] = b;
+            }
+        }
+    }
+    return true;
 }
 
-Node *KDG::getNodeFromName(string name) {
-    for (Knob *knob : knobs_) {
-        if (knob->getName().compare(name) == 0) {
-            return knob;
+bool KDG::addDependency(Basic *sink, Basic *source) {
+    if (frozen_) {
+        LOG_ERROR("KDG " << appName_ << " is frozen, cannot add dependency " << sink->getName()
+                  << " <- " << source->getName());
+        return false;
+    }
+    edges_.push_back(make_pair(sink, source));
+    return true;
+}
+
+void KDG::freeze(bool reduce_deps) {
+    if (!frozen_) {
+        for (Knob *knob : knobs_) {
+            bool empty = true;
+            for (Level *lvl : *(knob->getLevelNodes())) {
+                empty &= lvl->getBasicNodes()->empty();
+            }
+            if (empty) {
+                LOG_ERROR("KDG " << appName_ << ": knob " << knob->getName() << " has no levels, left out");
+            }
         }
-        for (Level *lvl : *(knob->getLevelNodes())) {
-            for (Basic *b : *(lvl->getBasicNodes())) {
-                if (b->getName().compare(name) == 0) {
-                    return b;
-                }
+        flat_.build(&knobs_, &edges_);
+        edges_.clear();
+        edges_.shrink_to_fit();
+        
+        // order the dependencies, and on request drop the redundant ones;
+        // the result is saved along with the graph
+        DepGraph deps(&flat_);
+        deps.sortTopological();
+        for (vector<unsigned> &cycle : *deps.getCycles()) {
+            string nodes;
+            for (unsigned i : cycle) {
+                nodes += " " + string(flat_.getBasicName(i));
             }
+            LOG_ERROR("KDG " << appName_ << ": dependency cycle through" << nodes);
         }
+        if (reduce_deps) {
+            deps.reduce();
+        }
+        LOG_INFO("KDG " << appName_ << ": " << flat_.getNumKnobs() << " knobs, "
+                 << flat_.getNumBasics() << " basic nodes, " << flat_.getNumEdges() << " edges ("
+                 << deps.getNumRemovedEdges() << " implied ones dropped)");
     }
-    return NULL;
+    frozen_ = true;
 }
 
-string KDG::getName(){
-    return appName_;
+bool KDG::isFrozen() { return frozen_; }
+
+Node *KDG::getNodeFromName(string_view name) {
+    Knob *knob = getKnobFromName(name);
+    if (knob != NULL) {
+        return knob;
+    }
+    return getBasicFromName(name);
 }
 
-KDG::~KDG() {
-    for (Knob *knob : knobs_) {
-        delete knob;
+Knob *KDG::getKnobFromName(string_view name) { return getKnobFromNameId(names_.find(name)); }
+
+Basic *KDG::getBasicFromName(string_view name) { return getBasicFromNameId(names_.find(name)); }
+
+Knob *KDG::getKnobFromNameId(uint32_t id) { return id < knobIndex_.size() ? knobIndex_[id] : NULL; }
+
+Basic *KDG::getBasicFromNameId(uint32_t id) { return id < basicIndex_.size() ? basicIndex_[id] : NULL; }
+
+vector<Knob *> *KDG::getKnobs() { return &knobs_; }
+
+FlatKDG *KDG::getFlat() { return &flat_; }
+
+bool KDG::loadFlat(string path, const FlatSource &source) {
+    if (frozen_ || !flat_.load(path, &source)) {
+        return false;
     }
+    frozen_ = true;
+    return true;
+}
+
+string KDG::getName(){
+    return appName_;
 }
@@ -1,17 +1,34 @@
+#ifndef KDG_H
+#define KDG_H
+
+#include "Arena.h"
+#include "FlatKDG.h"
+#include "NameTable.h"
 #include <map>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
 using namespace std;
 
+class KDG;
+
 // Base class for Top, Level, and Basic nodes
+// Nodes live in the arena of the KDG that created them (KDG::newKnob,
+// KDG::newLevel, KDG::newBasic) and are released together with it.
+// Names are interned in the graph's NameTable, a node only keeps the id.
 class Node {
 private:
-    string name_;
+    KDG *graph_;
+    uint32_t nameId_;
     
 public:
-    void setName(string name);
-    string getName();
+    Node(KDG *graph);
+    void setName(string_view name);
+    string_view getName();                        // view into the graph's NameTable
+    uint32_t getNameId();
+    KDG *getGraph();
     
 };
 
@@ -20,15 +37,17 @@ class Basic : public Node {
 private:
     float cost_;
     float quality_;
-    vector<Basic *> dependencies_;
+    unsigned index_; // position in the FlatKDG, set by KDG::freeze(), UINT32_MAX once pruned
     
 public:
-    Basic(string name);
+    Basic(KDG *graph, string_view name);
+    unsigned getIndex();
+    void setIndex(unsigned idx);
     void setCost(float cost);
     void setQuality(float quality);
     float getCost();
     float getQuality();
-    void addDependency(Basic * source);
+    void addDependency(Basic * source);           // this node needs source, see KDG::addDependency
 };
 
 // Level nodes - a level in a knob which may contain multiple nodes,
@@ -36,37 +55,63 @@ public:
 class Level : public Node {
 private:
     int level_;
-    vector<Basic *> basicNodes_;
+    ArenaVector<Basic *> basicNodes_;
     
 public:
-    Level(int lvl);
-    vector<Basic *> *getBasicNodes();
+    Level(KDG *graph, int lvl);
+    ArenaVector<Basic *> *getBasicNodes();
     void addBasicNode(Basic * node);
     int getLevelNum();
-    ~Level();
 };
 
 // Top nodes - represent a knob
 class Knob : public Node {
 private:
-    vector<Level *> levelNodes_;
+    ArenaVector<Level *> levelNodes_;
 public:
-    Knob(string name);
-    vector<Level *> *getLevelNodes();
+    Knob(KDG *graph, string_view name);
+    ArenaVector<Level *> *getLevelNodes();
     void addLevelNode(Level *);
-    ~Knob();
 };
 
 // Main Data Structure
+// Knobs and their basic nodes are indexed by interned name id as they are
+// added, so any lookup is a single hash probe. Once loading is done the
+// graph is frozen.
+// A dependency sink <- source means: when the sink is chosen, one of its
+// sources in each knob it depends on must be chosen as well.
 class KDG {
 private:
+    Arena arena_; // owns every node, tearing the graph down is freeing its blocks
+    NameTable names_;
     string appName_;
     vector<Knob *> knobs_;
+    vector<Knob *> knobIndex_;    // by name id, NULL if no knob has that name
+    vector<Basic *> basicIndex_;
+    vector<pair<Basic *, Basic *> > edges_; // (sink, source), compiled into CSR on freeze
+    bool frozen_;
+    FlatKDG flat_;
     
 public:
     KDG(string app_name);
-    void addKnob(Knob *knob);                     // add a knob
-    Node *getNodeFromName(string name);           // get a node from the name
+    Knob *newKnob(string_view name);              // allocate nodes in the graph's arena
+    Level *newLevel(int lvl);
+    Basic *newBasic(string_view name);
+    Arena *getArena();
+    NameTable *getNames();
+    bool addKnob(Knob *knob);                     // add a fully built knob, false once frozen
+    bool addDependency(Basic *sink, Basic *source); // add an edge, false once frozen
+    void freeze(bool reduce_deps = false);        // done loading, no more knobs; compiles the FlatKDG and sorts (and optionally reduces) its dependencies (DepGraph)
+    bool isFrozen();
+    Node *getNodeFromName(string_view name);      // get a node from the name
+    Knob *getKnobFromName(string_view name);      // same, restricted to knobs
+    Basic *getBasicFromName(string_view name);    // same, restricted to basic nodes
+    Knob *getKnobFromNameId(uint32_t id);         // lookups by interned name id
+    Basic *getBasicFromNameId(uint32_t id);
+    vector<Knob *> *getKnobs();
+    FlatKDG *getFlat();                           // compiled graph, only valid once frozen
+    bool loadFlat(string path, const FlatSource &source); // take a saved FlatKDG, compiled from source, as the (frozen) graph
     string getName();
-    ~KDG();
 };
+
+#endif
@@ -0,0 +1,85 @@
+#include "KDGCache.h"
+#include "Log.h"
+#include <cstdio>
+#include <cstring>
+#include <unistd.h>
+
+using namespace std;
+
+KDGCache::KDGCache(string dir):dir_(dir) {
+    if (!dir_.empty() && dir_.back() != '/') {
+        dir_ += '/';
+    }
+}
+
+// the 64 bit finalizer of MurmurHash3: every input bit reaches every
+// output bit, which a plain FNV multiply does not do for whole words
+static uint64_t mixWord(uint64_t word) {
+    word ^= word >> 33;
+    word *= 0xff51afd7ed558ccdULL;
+    word ^= word >> 33;
+    word *= 0xc4ceb9fe1a85ec53ULL;
+    word ^= word >> 33;
+    return word;
+}
+
+// Two FNV style chains over mixed 8 byte words, a single cheap pass over
+// the input giving 128 bits. The key uses the first, the cache file keeps
+// both (it is not meant to resist crafted collisions).
+string KDGCache::getKey(const char *text, size_t size, string kind, FlatSource &source) {
+    const uint64_t prime = 0x100000001b3ULL;
+    uint64_t hash[2] = {0xcbf29ce484222325ULL, 0x84222325cbf29ce4ULL};
+    auto add = [&](uint64_t word) {
+        uint64_t mixed = mixWord(word);
+        hash[0] = (hash[0] ^ mixed) * prime;
+        hash[1] = (hash[1] ^ mixWord(mixed ^ 0x9e3779b97f4a7c15ULL)) * prime;
+    };
+    for (char c : kind) {
+        add((unsigned char)c);
+    }
+    add(size);
+    
+    size_t i = 0;
+    uint64_t word;
+    for (; i + 8 <= size; i += 8) {
+        memcpy(&word, text + i, 8);
+        add(word);
+    }
+    if (i < size) {
+        word = 0;
+        memcpy(&word, text + i, size - i);
+        add(word);
+    }
+    source.size = size;
+    source.hash[0] = mixWord(hash[0]);
+    source.hash[1] = mixWord(hash[1]);
+    
+    char hex[17];
+    snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)source.hash[0]);
+    return kind + "-" + hex;
+}
+
+string KDGCache::getPath(string key) { return dir_ + key + ".kdg"; }
+
+bool KDGCache::load(string key, const FlatSource &source, KDG *graph) {
+    if (!graph->loadFlat(getPath(key), source)) {
+        LOG_DEBUG("cache miss " << getPath(key));
+        return false;
+    }
+    LOG_INFO("loaded " << graph->getName() << " from cache " << getPath(key));
+    return true;
+}
+
+bool KDGCache::store(string key, const FlatSource &source, KDG *graph) {
+    // write aside and rename, so concurrent runs never map a partial file
+    string path = getPath(key);
+    string tmp = path + ".tmp" + to_string(getpid());
+    graph->getFlat()->setSource(source);
+    if (!graph->getFlat()->save(tmp) || rename(tmp.c_str(), path.c_str()) != 0) {
+        LOG_ERROR("could not write cache file " << path);
+        unlink(tmp.c_str());
+        return false;
+    }
+    LOG_INFO("cached " << graph->getName() << " in " << path);
+    return true;
+}
@@ -0,0 +1,25 @@
+#ifndef KDGCACHE_H
+#define KDGCACHE_H
+
+#include "KDG.h"
+#include <string>
+
+using namespace std;
+
+// Directory of compiled KDGs (FlatKDG binaries) keyed by a hash of the
+// source file contents, so a run on an unchanged input maps the compiled
+// graph instead of parsing it again. Each file also records the size and
+// the full hash of its source, checked on load.
+class KDGCache {
+private:
+    string dir_;
+    
+public:
+    KDGCache(string dir);
+    static string getKey(const char *text, size_t size, string kind, FlatSource &source); // content hash of an input, source gets its stamp
+    string getPath(string key);
+    bool load(string key, const FlatSource &source, KDG *graph); // false on a miss
+    bool store(string key, const FlatSource &source, KDG *graph);
+};
+
+#endif
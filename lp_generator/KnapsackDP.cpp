@@ -0,0 +1,328 @@
+#include "KnapsackDP.h"
+#include "Log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+
+using namespace std;
+
+KnapsackDP::KnapsackDP(FlatKDG *flat):flat_(flat), grouped_(false), groupsOk_(false) {}
+
+unsigned KnapsackDP::getNumGroups() { return itemBegin_.empty() ? 0 : itemBegin_.size() - 1; }
+
+static unsigned findRoot(vector<unsigned> &parent, unsigned k) {
+    while (parent[k] != k) {
+        parent[k] = parent[parent[k]];
+        k = parent[k];
+    }
+    return k;
+}
+
+bool KnapsackDP::buildGroups() {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    unsigned num_knobs = flat_->getNumKnobs();
+    
+    // knobs joined by any dependency end up in the same group
+    vector<unsigned> parent(num_knobs);
+    iota(parent.begin(), parent.end(), 0);
+    for (unsigned i = 0; i < flat_->getNumBasics(); i++) {
+        for (unsigned e = dep_begin[i]; e < dep_begin[i + 1]; e++) {
+            unsigned a = findRoot(parent, knob_of[i]), b = findRoot(parent, knob_of[dep_sources[e]]);
+            parent[max(a, b)] = min(a, b);
+        }
+    }
+    vector<vector<unsigned> > members(num_knobs);
+    for (unsigned k = 0; k < num_knobs; k++) {
+        members[findRoot(parent, k)].push_back(k);
+    }
+    
+    itemBegin_.assign(1, 0);
+    groupKnobBegin_.assign(1, 0);
+    for (unsigned k = 0; k < num_knobs; k++) {
+        if (!members[k].empty() && !enumerateGroup(members[k])) {
+            LOG_ERROR("knobs " << flat_->getKnobName(k) << " and the " << members[k].size() - 1
+                      << " tied to it by dependencies have too many joint choices for the dp solver");
+            return false;
+        }
+    }
+    itemChoiceBegin_.push_back(itemChoice_.size());
+    LOG_INFO("dp: " << getNumGroups() << " groups, " << itemCost_.size() << " items");
+    return true;
+}
+
+// Depth first over the group's knobs, checking each dependency row as soon
+// as both the sink's and the sources' knobs have a level. Items no better
+// than a cheaper one are dropped, the group has no other ties. Rows may
+// cut most partial choices before any item is complete, so the partial
+// choices tried are capped as well as the items.
+bool KnapsackDP::enumerateGroup(vector<unsigned> &knobs) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    unsigned n = knobs.size();
+    
+    // rows, by the position in knobs at which they can be checked
+    struct Row { unsigned sink, begin, end, sink_pos, source_pos; };
+    vector<vector<Row> > rows_at(n);
+    for (unsigned p = 0; p < n; p++) {
+        for (unsigned i = knob_begin[knobs[p]]; i < knob_begin[knobs[p] + 1]; i++) {
+            for (unsigned e = dep_begin[i]; e < dep_begin[i + 1];) {
+                unsigned end = e;
+                while (end < dep_begin[i + 1] && knob_of[dep_sources[end]] == knob_of[dep_sources[e]]) {
+                    end++;
+                }
+                unsigned sp = lower_bound(knobs.begin(), knobs.end(), knob_of[dep_sources[e]]) - knobs.begin();
+                rows_at[max(p, sp)].push_back(Row{i, e, end, p, sp});
+                e = end;
+            }
+        }
+    }
+    
+    struct Item { double cost; float quality; unsigned choice; };
+    vector<Item> items;
+    vector<unsigned> choices; // n per item
+    vector<unsigned> pick(n);
+    uint64_t tried = 0;
+    bool overflow = false;
+    
+    auto ok_at = [&](unsigned p) {
+        for (Row &row : rows_at[p]) {
+            if (pick[row.sink_pos] == row.sink &&
+                !binary_search(dep_sources + row.begin, dep_sources + row.end, pick[row.source_pos])) {
+                return false;
+            }
+        }
+        return true;
+    };
+    
+    // iterative, so large groups cannot run the stack out
+    vector<unsigned> next(n);
+    unsigned p = 0;
+    next[0] = knob_begin[knobs[0]];
+    while (!overflow) {
+        if (next[p] == knob_begin[knobs[p] + 1]) {
+            if (p == 0) {
+                break;
+            }
+            p--;
+            continue;
+        }
+        pick[p] = next[p]++;
+        if (++tried > MAX_GROUP_NODES) {
+            overflow = true;
+            break;
+        }
+        if (!ok_at(p)) {
+            continue;
+        }
+        if (p + 1 < n) {
+            p++;
+            next[p] = knob_begin[knobs[p]];
+            continue;
+        }
+        double c = 0;
+        float q = 0;
+        for (unsigned x = 0; x < n; x++) {
+            c += cost[pick[x]];
+            q += quality[pick[x]];
+        }
+        items.push_back(Item{c, q, (unsigned)choices.size()});
+        choices.insert(choices.end(), pick.begin(), pick.end());
+        overflow = items.size() > MAX_GROUP_ITEMS * 4;
+    }
+    
+    sort(items.begin(), items.end(), [](const Item &a, const Item &b) {
+        return a.cost != b.cost ? a.cost < b.cost : a.quality > b.quality;
+    });
+    float best = -INFINITY;
+    unsigned kept = 0;
+    for (Item &item : items) {
+        if (item.quality > best) {
+            best = item.quality;
+            itemCost_.push_back(item.cost);
+            itemQuality_.push_back(item.quality);
+            itemChoiceBegin_.push_back(itemChoice_.size());
+            itemChoice_.insert(itemChoice_.end(), choices.begin() + item.choice, choices.begin() + item.choice + n);
+            kept++;
+        }
+    }
+    if (overflow || kept > MAX_GROUP_ITEMS) {
+        return false;
+    }
+    groupKnobs_.insert(groupKnobs_.end(), knobs.begin(), knobs.end());
+    groupKnobBegin_.push_back(groupKnobs_.size());
+    itemBegin_.push_back(itemCost_.size());
+    return true;
+}
+
+bool KnapsackDP::solve(float budget, Solution &sol) {
+    if (!grouped_) {
+        groupsOk_ = buildGroups();
+        grouped_ = true;
+    }
+    sol = Solution();
+    if (!groupsOk_) {
+        return false;
+    }
+    unsigned num_groups = getNumGroups();
+    
+    // shift every group so its cheapest item costs nothing
+    vector<double> min_cost(num_groups);
+    double base = 0;
+    bool whole = true;
+    for (unsigned g = 0; g < num_groups; g++) {
+        if (itemBegin_[g] == itemBegin_[g + 1]) {
+            return true; // a group with no allowed choice, nothing is feasible
+        }
+        min_cost[g] = itemCost_[itemBegin_[g]];
+        base += min_cost[g];
+        for (unsigned it = itemBegin_[g]; it < itemBegin_[g + 1]; it++) {
+            double c = itemCost_[it] - min_cost[g];
+            whole &= (c == floor(c));
+        }
+    }
+    if (budget < base) {
+        return true;
+    }
+    
+    // cost cells: whole costs as they are when the table fits, else a grid;
+    // either way costs are only rounded up and the budget only down
+    double span = budget - base;
+    size_t max_cells = min((size_t)MAX_CELLS, MAX_TABLE / max(num_groups, 1u));
+    double scale = 1;
+    bool exact = whole && span < max_cells;
+    if (!exact && span > 0) {
+        scale = (max_cells - 1) / span;
+        LOG_INFO("dp: costs rounded up to steps of " << 1 / scale);
+    }
+    size_t cells = (size_t)floor(span * scale) + 1;
+    vector<unsigned> weight(itemCost_.size());
+    for (unsigned g = 0; g < num_groups; g++) {
+        for (unsigned it = itemBegin_[g]; it < itemBegin_[g + 1]; it++) {
+            weight[it] = (unsigned)ceil((itemCost_[it] - min_cost[g]) * scale);
+        }
+    }
+    
+    // best[c]: best quality of the groups so far within c cells
+    vector<float> best(cells, 0), next(cells);
+    vector<uint16_t> taken(num_groups * cells);
+    for (unsigned g = 0; g < num_groups; g++) {
+        uint16_t *row = &taken[g * cells];
+        fill(next.begin(), next.end(), -INFINITY);
+        for (unsigned it = itemBegin_[g]; it < itemBegin_[g + 1]; it++) {
+            unsigned w = weight[it];
+            float q = itemQuality_[it];
+            uint16_t idx = it - itemBegin_[g];
+            for (size_t c = w; c < cells; c++) {
+                float cand = best[c - w] + q;
+                if (cand > next[c]) {
+                    next[c] = cand;
+                    row[c] = idx;
+                }
+            }
+        }
+        best.swap(next);
+    }
+    // walk back through the table from the last cell; should the grid
+    // have rounded a sum below the budget that is not, in exact sums, the
+    // next cell down holds the best answer of a smaller budget
+    vector<unsigned> choice(flat_->getNumKnobs());
+    for (size_t top = cells; top-- > 0 && !isinf(best[top]);) {
+        size_t c = top;
+        double total = 0;
+        for (unsigned g = num_groups; g-- > 0;) {
+            unsigned it = itemBegin_[g] + taken[g * cells + c];
+            for (unsigned x = groupKnobBegin_[g]; x < groupKnobBegin_[g + 1]; x++) {
+                choice[groupKnobs_[x]] = itemChoice_[itemChoiceBegin_[it] + x - groupKnobBegin_[g]];
+            }
+            total += itemCost_[it];
+            c -= weight[it];
+        }
+        if (total <= budget) {
+            sol.setChoice(flat_, choice);
+            if (exact) {
+                sol.setBound(sol.getQuality());
+            }
+            return true;
+        }
+    }
+    return true;
+}
+
+// Group by group, the frontier so far plus every item of the next group,
+// keeping the points no cheaper point beats. Each point remembers the one
+// it came from and the item added, so configurations are only rebuilt at
+// the end, walking back from every final point.
+bool KnapsackDP::solveFrontier(vector<double> &cost, vector<float> &quality,
+                               const function<void(const vector<unsigned> &)> &visit) {
+    if (!grouped_) {
+        groupsOk_ = buildGroups();
+        grouped_ = true;
+    }
+    cost.clear();
+    quality.clear();
+    if (!groupsOk_) {
+        return false;
+    }
+    unsigned num_groups = getNumGroups();
+    
+    struct Point { double cost, quality; unsigned from; uint16_t item; };
+    vector<vector<Point> > steps(num_groups);
+    vector<Point> start(1, Point{0, 0, 0, 0}), merged;
+    size_t stored = 0;
+    for (unsigned g = 0; g < num_groups; g++) {
+        const vector<Point> &last = g > 0 ? steps[g - 1] : start;
+        size_t num_items = itemBegin_[g + 1] - itemBegin_[g];
+        if (last.size() * num_items > MAX_FRONTIER << 6 || stored > MAX_TABLE) {
+            LOG_ERROR("the frontier grows too large at knob " << flat_->getKnobName(groupKnobs_[groupKnobBegin_[g]]));
+            return false;
+        }
+        merged.clear();
+        for (unsigned p = 0; p < last.size(); p++) {
+            for (unsigned it = itemBegin_[g]; it < itemBegin_[g + 1]; it++) {
+                merged.push_back(Point{last[p].cost + itemCost_[it], last[p].quality + itemQuality_[it], p,
+                                       (uint16_t)(it - itemBegin_[g])});
+            }
+        }
+        sort(merged.begin(), merged.end(), [](const Point &a, const Point &b) {
+            return a.cost != b.cost ? a.cost < b.cost : a.quality > b.quality;
+        });
+        double best = -INFINITY;
+        for (Point &point : merged) {
+            if (point.quality > best) {
+                best = point.quality;
+                steps[g].push_back(point);
+            }
+        }
+        if (steps[g].size() > MAX_FRONTIER) {
+            LOG_ERROR("the frontier grows too large at knob " << flat_->getKnobName(groupKnobs_[groupKnobBegin_[g]]));
+            return false;
+        }
+        stored += steps[g].size();
+    }
+    const vector<Point> &final_points = num_groups > 0 ? steps.back() : start;
+    LOG_INFO("dp: frontier of " << final_points.size() << " points");
+    
+    vector<unsigned> choice(flat_->getNumKnobs());
+    for (unsigned p = 0; p < final_points.size(); p++) {
+        cost.push_back(final_points[p].cost);
+        quality.push_back(final_points[p].quality);
+        unsigned at = p;
+        for (unsigned g = num_groups; g-- > 0;) {
+            const Point &point = steps[g][at];
+            unsigned it = itemBegin_[g] + point.item;
+            for (unsigned x = groupKnobBegin_[g]; x < groupKnobBegin_[g + 1]; x++) {
+                choice[groupKnobs_[x]] = itemChoice_[itemChoiceBegin_[it] + x - groupKnobBegin_[g]];
+            }
+            at = point.from;
+        }
+        visit(choice);
+    }
+    return true;
+}
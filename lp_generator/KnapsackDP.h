@@ -0,0 +1,56 @@
+#ifndef KNAPSACKDP_H
+#define KNAPSACKDP_H
+
+#include "FlatKDG.h"
+#include "Solution.h"
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+// Exact solver for the KDG as a multiple-choice knapsack: one level per
+// knob, total cost within the budget, summed quality as high as possible.
+// Knobs tied together by dependencies are merged into one group whose items
+// are the joint level choices that meet those dependencies, so the groups
+// are independent and a dynamic program over (group, cost) solves it in
+// time groups x items x budget cells. Costs are shifted so the cheapest
+// item of a group is free; when the rest are whole numbers the table is
+// exact, otherwise costs are rounded up (and the budget down) onto a grid
+// of at most MAX_CELLS cells and the result is feasible but only optimal
+// on that grid.
+// Groups are built once and reused for every budget solved.
+// solveFrontier() merges the groups' items into the exact (cost, quality)
+// Pareto frontier over all budgets instead, see ParetoTable.
+class KnapsackDP {
+private:
+    FlatKDG *flat_;
+    bool grouped_;
+    bool groupsOk_;
+    vector<unsigned> groupKnobBegin_; // knobs of group g: groupKnobs_[groupKnobBegin_[g] ..]
+    vector<unsigned> groupKnobs_;
+    vector<unsigned> itemBegin_;      // items of group g: [itemBegin_[g], itemBegin_[g + 1])
+    vector<double> itemCost_;         // summed in double, solveFrontier() keeps them exact
+    vector<float> itemQuality_;
+    vector<unsigned> itemChoice_;     // basic node of each of the group's knobs, item after item
+    vector<unsigned> itemChoiceBegin_;
+    
+    bool buildGroups();
+    bool enumerateGroup(vector<unsigned> &knobs);
+    
+public:
+    static const unsigned MAX_GROUP_ITEMS = 1 << 14;
+    static const uint64_t MAX_GROUP_NODES = (uint64_t)MAX_GROUP_ITEMS << 8; // partial choices tried for a group
+    static const unsigned MAX_CELLS = 1 << 20;
+    static const size_t MAX_TABLE = (size_t)1 << 27; // cells of the choice table, over all groups
+    static const size_t MAX_FRONTIER = 1 << 16;      // points of the frontier, after any group
+    
+    KnapsackDP(FlatKDG *flat);
+    bool solve(float budget, Solution &sol);      // false if a group is too large for the table
+    // frontier points cheapest first, visit gets the choice of each in turn;
+    // false if a group or the frontier is too large
+    bool solveFrontier(vector<double> &cost, vector<float> &quality,
+                       const function<void(const vector<unsigned> &)> &visit);
+    unsigned getNumGroups();
+};
+
+#endif
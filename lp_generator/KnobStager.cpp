@@ -0,0 +1,228 @@
+#include "KnobStager.h"
+#include "Decode.h"
+#include "rapidxml.hpp"
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+using namespace std;
+using namespace rapidxml;
+
+KnobStager::KnobStager(const char *text, size_t size):text_(text), size_(size) {}
+
+static bool startsWith(const char *p, const char *end, const char *prefix) {
+    size_t n = strlen(prefix);
+    return (size_t)(end - p) >= n && memcmp(p, prefix, n) == 0;
+}
+
+// A scan over the tags only, which sees the document as the DOM path does:
+// the knobs are the <knob> children of the first root element, comments,
+// CDATA, declarations and processing instructions are skipped, a quoted
+// attribute value may hold '>', only whitespace goes between top level
+// nodes, and every element has to be closed. Like rapidxml with
+// parse_fastest, closing tag names are not compared, and the text ends at
+// the first null. What is inside a knob is left to its worker.
+bool KnobStager::findKnobs(string &error) {
+    const char *end = (const char *)memchr(text_, '\0', size_);
+    end = end ? end : text_ + size_;
+    const char *p = text_;
+    if (startsWith(p, end, "\xEF\xBB\xBF")) {
+        p += 3;
+    }
+    unsigned depth = 0;
+    bool root_seen = false;  // the first root element, the only one read
+    bool root_done = false;
+    size_t knob_begin = 0;
+    slices_.clear();
+    
+    auto fail = [&](const char *at, string what) {
+        error = "offset " + to_string(at - text_) + ": " + what;
+        return false;
+    };
+    auto skipTo = [&](const char *from, const char *closing, string what) {
+        const char *found = (const char *)memmem(from, end - from, closing, strlen(closing));
+        if (found == NULL) {
+            return fail(from, "unterminated " + what);
+        }
+        p = found + strlen(closing);
+        return true;
+    };
+    
+    while (p < end) {
+        const char *lt = (const char *)memchr(p, '<', end - p);
+        if (depth == 0) {
+            for (const char *c = p; c < (lt ? lt : end); c++) {
+                if (!isspace((unsigned char)*c)) {
+                    return fail(c, "expected <");
+                }
+            }
+        }
+        if (lt == NULL) {
+            break;
+        }
+        p = lt;
+        
+        if (startsWith(p, end, "<!--")) {
+            if (!skipTo(p + 4, "-->", "comment")) return false;
+            continue;
+        }
+        if (startsWith(p, end, "<![CDATA[")) {
+            if (!skipTo(p + 9, "]]>", "CDATA")) return false;
+            continue;
+        }
+        if (startsWith(p, end, "<?")) {
+            if (!skipTo(p + 2, "?>", "processing instruction")) return false;
+            continue;
+        }
+        if (startsWith(p, end, "<!")) {
+            // <!DOCTYPE ...> and the like, which may hold [ ... ] with '>' inside
+            int brackets = 0;
+            const char *q = p + 2;
+            for (; q < end && (*q != '>' || brackets > 0); q++) {
+                brackets += (*q == '[') - (*q == ']');
+            }
+            if (q == end) {
+                return fail(p, "unterminated declaration");
+            }
+            p = q + 1;
+            continue;
+        }
+        
+        // an element tag, up to the first '>' outside quotes
+        bool closing = (p + 1 < end && p[1] == '/');
+        const char *name = p + 1 + closing;
+        const char *name_end = name;
+        while (name_end < end && !isspace((unsigned char)*name_end) && *name_end != '/' && *name_end != '>') {
+            name_end++;
+        }
+        if (name_end == name) {
+            return fail(p, "expected element name");
+        }
+        char quote = 0;
+        const char *gt = name_end;
+        for (; gt < end && (quote || *gt != '>'); gt++) {
+            if (quote) {
+                quote = (*gt == quote) ? 0 : quote;
+            } else if (*gt == '"' || *gt == '\'') {
+                quote = *gt;
+            }
+        }
+        if (gt == end) {
+            return fail(p, "unterminated tag");
+        }
+        bool empty = !closing && gt[-1] == '/';
+        string_view tag(name, name_end - name);
+        
+        if (closing) {
+            if (depth == 0) {
+                return fail(p, "closing tag outside of any element");
+            }
+            depth--;
+            if (depth == 1 && root_seen && !root_done && knob_begin != 0) {
+                slices_.push_back(make_pair(knob_begin - 1, gt + 1 - text_));
+                knob_begin = 0;
+            }
+            root_done = root_done || (depth == 0 && root_seen);
+        } else {
+            bool is_knob = (depth == 1 && root_seen && !root_done && tag == "knob");
+            if (is_knob && empty) {
+                slices_.push_back(make_pair(p - text_, gt + 1 - text_));
+            } else if (is_knob) {
+                knob_begin = p - text_ + 1; // 0 means outside any knob
+            }
+            root_seen = true;
+            depth += !empty;
+            root_done = root_done || (depth == 0);
+        }
+        p = gt + 1;
+    }
+    if (depth != 0) {
+        return fail(end, "unexpected end of data, " + to_string(depth) + " element(s) left open");
+    }
+    if (!root_seen) {
+        error = "no root element";
+        return false;
+    }
+    return true;
+}
+
+void KnobStager::stageBatch(unsigned batch) {
+    StagedBatch &out = batches_[batch];
+    xml_document<> doc;
+    string copy; // rapidxml wants a null terminated text, one knob at a time
+    
+    unsigned first = batch * KNOBS_PER_BATCH;
+    unsigned last = min<size_t>(first + KNOBS_PER_BATCH, slices_.size());
+    for (unsigned k = first; k < last; k++) {
+        const char *slice = text_ + slices_[k].first;
+        copy.assign(slice, slices_[k].second - slices_[k].first);
+        
+        // views into the copy are translated back into the input
+        auto view = [&](const char *p, size_t n) {
+            return string_view(slice + (p - copy.data()), n);
+        };
+        auto value = [&](xml_base<> *node) { return view(node->value(), node->value_size()); };
+        
+        doc.clear();
+        try {
+            doc.parse<parse_fastest>(&copy[0]);
+        } catch (parse_error &err) {
+            out.error = err.what();
+            out.errorOffset = slices_[k].first + (err.where<char>() - copy.data());
+            return;
+        }
+        
+        xml_node<> *knob = doc.first_node("knob");
+        xml_node<> *knob_name = knob->first_node("knobname");
+        out.fields.push_back({StagedField::KNOB, true, 0, knob_name ? value(knob_name) : string_view()});
+        
+        for (xml_node<> *level = knob->first_node("knoblayer"); level;
+             level = level->next_sibling("knoblayer")) {
+            out.fields.push_back({StagedField::LEVEL, true, 0, string_view()});
+            for (xml_node<> *basic = level->first_node("basicnode"); basic;
+                 basic = basic->next_sibling("basicnode")) {
+                out.fields.push_back({StagedField::BASIC, true, 0, string_view()});
+                for (xml_node<> *field = basic->first_node(); field; field = field->next_sibling()) {
+                    string_view name(field->name(), field->name_size());
+                    StagedField staged = {StagedField::NAME, true, 0, value(field)};
+                    if (name == "cost" || name == "quality") {
+                        staged.kind = (name == "cost") ? StagedField::COST : StagedField::QUALITY;
+                        staged.ok = decodeFloat(staged.text.data(), staged.text.data() + staged.text.size(),
+                                                staged.val);
+                    } else if (name == "and") {
+                        staged.kind = StagedField::AND;
+                    } else if (name != "nodename") {
+                        continue;
+                    }
+                    out.fields.push_back(staged);
+                }
+            }
+        }
+    }
+}
+
+void KnobStager::stage(unsigned threads) {
+    unsigned num_batches = (slices_.size() + KNOBS_PER_BATCH - 1) / KNOBS_PER_BATCH;
+    batches_.assign(num_batches, StagedBatch());
+    
+    // workers pull the next batch off a shared counter, which balances the
+    // load; every batch keeps its slot, so the output order is fixed
+    atomic<unsigned> next(0);
+    auto work = [&]() {
+        for (unsigned b = next++; b < num_batches; b = next++) {
+            stageBatch(b);
+        }
+    };
+    vector<thread> workers;
+    for (unsigned t = 1; t < threads && t < num_batches; t++) {
+        workers.push_back(thread(work));
+    }
+    work();
+    for (thread &worker : workers) {
+        worker.join();
+    }
+}
+
+unsigned KnobStager::getNumKnobs() { return slices_.size(); }
+
+vector<StagedBatch> *KnobStager::getBatches() { return &batches_; }
@@ -0,0 +1,54 @@
+#ifndef KNOBSTAGER_H
+#define KNOBSTAGER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// One piece of a knob subtree as parsed by a worker, in document order:
+// KNOB (text is the knob name), LEVEL, BASIC, then that node's fields.
+// Text is a view into the input, never into worker memory.
+struct StagedField {
+    enum Kind { KNOB, LEVEL, BASIC, NAME, COST, QUALITY, AND };
+    Kind kind;
+    bool ok;          // COST / QUALITY decoded fine
+    float val;
+    string_view text;
+};
+
+// A run of consecutive knobs parsed by one worker. A knob that fails to
+// parse ends its batch, error says why.
+struct StagedBatch {
+    vector<StagedField> fields;
+    string error;
+    size_t errorOffset;
+};
+
+// Parses the <knob> subtrees of an XML input on several threads. Knobs are
+// independent until dependencies get resolved, so each worker takes batches
+// of knobs with its own XML parser and buffers; the batches come back in
+// input order, for the caller to merge into the KDG deterministically.
+class KnobStager {
+private:
+    const char *text_;
+    size_t size_;
+    vector<pair<size_t, size_t> > slices_; // [begin, end) of each <knob> element
+    vector<StagedBatch> batches_;
+    
+    void stageBatch(unsigned batch);
+    
+public:
+    static const unsigned KNOBS_PER_BATCH = 64;
+    
+    KnobStager(const char *text, size_t size);
+    bool findKnobs(string &error);               // locate the knob elements, checking the document as the DOM path would
+    void stage(unsigned threads);
+    unsigned getNumKnobs();
+    vector<StagedBatch> *getBatches();
+};
+
+#endif
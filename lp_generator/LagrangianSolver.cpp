@@ -0,0 +1,346 @@
+#include "LagrangianSolver.h"
+#include "Log.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+
+using namespace std;
+
+LagrangianSolver::LagrangianSolver(FlatKDG *flat):flat_(flat), greedy_(flat), prepared_(false), threads_(1),
+    dualizeDeps_(false), timeLimit_(0), round_(0), busy_(0), stopping_(false), roundLambda_(0), nextRange_(0) {}
+
+LagrangianSolver::~LagrangianSolver() { stopWorkers(); }
+
+void LagrangianSolver::setThreads(unsigned threads) { threads_ = threads > 0 ? threads : 1; }
+
+void LagrangianSolver::setDualizeDependencies(bool dualize) { dualizeDeps_ = dualize; }
+
+void LagrangianSolver::setTimeLimit(double seconds) { timeLimit_ = seconds; }
+
+// everything that does not depend on the prices
+void LagrangianSolver::prepare() {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    unsigned num_knobs = flat_->getNumKnobs();
+    unsigned num_basics = flat_->getNumBasics();
+    
+    // rows sink by sink, and the rows every basic node is a source of
+    sinkRowBegin_.clear();
+    sourceRowsBegin_.assign(num_basics + 1, 0);
+    for (unsigned i = 0; i < num_basics; i++) {
+        sinkRowBegin_.push_back(rows_.size());
+        for (unsigned e = dep_begin[i]; e < dep_begin[i + 1];) {
+            unsigned end = e;
+            while (end < dep_begin[i + 1] && knob_of[dep_sources[end]] == knob_of[dep_sources[e]]) {
+                sourceRowsBegin_[dep_sources[end] + 1]++;
+                end++;
+            }
+            rows_.push_back(Row{i, e, end});
+            e = end;
+        }
+    }
+    sinkRowBegin_.push_back(rows_.size());
+    for (unsigned i = 0; i < num_basics; i++) {
+        sourceRowsBegin_[i + 1] += sourceRowsBegin_[i];
+    }
+    sourceRows_.resize(sourceRowsBegin_.back());
+    vector<unsigned> fill(sourceRowsBegin_.begin(), sourceRowsBegin_.end() - 1);
+    for (unsigned r = 0; r < rows_.size(); r++) {
+        for (unsigned e = rows_[r].begin; e < rows_[r].end; e++) {
+            sourceRows_[fill[dep_sources[e]]++] = r;
+        }
+    }
+    
+    // whole knobs of about BASICS_PER_RANGE basic nodes, as LpWriter does
+    rangeBegin_.assign(1, 0);
+    for (unsigned k = 1; k < num_knobs; k++) {
+        if (knob_begin[k] - knob_begin[rangeBegin_.back()] >= BASICS_PER_RANGE) {
+            rangeBegin_.push_back(k);
+        }
+    }
+    rangeBegin_.push_back(num_knobs);
+    
+    mu_.assign(rows_.size(), 0);
+    score_.resize(num_basics);
+    choice_.resize(num_knobs);
+    rangeCost_.resize(rangeBegin_.size() - 1);
+    rangeScore_.resize(rangeBegin_.size() - 1);
+    prepared_ = true;
+}
+
+// priced score of every level, then the best one of every knob
+void LagrangianSolver::evaluateRange(unsigned range, float lambda) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    unsigned first = knob_begin[rangeBegin_[range]], last = knob_begin[rangeBegin_[range + 1]];
+    float *score = score_.data();
+    
+    // kept apart from the row prices so the compiler vectorizes it
+    for (unsigned i = first; i < last; i++) {
+        score[i] = quality[i] - lambda * cost[i];
+    }
+    if (dualizeDeps_) {
+        for (unsigned i = first; i < last; i++) {
+            float price = 0;
+            for (unsigned r = sourceRowsBegin_[i]; r < sourceRowsBegin_[i + 1]; r++) {
+                price += mu_[sourceRows_[r]];
+            }
+            for (unsigned r = sinkRowBegin_[i]; r < sinkRowBegin_[i + 1]; r++) {
+                price -= mu_[r];
+            }
+            score[i] += price;
+        }
+    }
+    
+    double range_cost = 0, range_score = 0;
+    for (unsigned k = rangeBegin_[range]; k < rangeBegin_[range + 1]; k++) {
+        unsigned best = knob_begin[k];
+        for (unsigned i = knob_begin[k] + 1; i < knob_begin[k + 1]; i++) {
+            if (score[i] > score[best]) {
+                best = i;
+            }
+        }
+        choice_[k] = best;
+        range_cost += cost[best];
+        range_score += score[best];
+    }
+    rangeCost_[range] = range_cost;
+    rangeScore_[range] = range_score;
+}
+
+// one worker less than threads_, the caller of evaluate() being the last
+void LagrangianSolver::startWorkers() {
+    unsigned num_ranges = rangeBegin_.size() - 1;
+    for (unsigned t = 1; t < threads_ && t < num_ranges; t++) {
+        workers_.push_back(thread(&LagrangianSolver::workerLoop, this));
+    }
+}
+
+void LagrangianSolver::stopWorkers() {
+    {
+        lock_guard<mutex> lock(poolLock_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (thread &worker : workers_) {
+        worker.join();
+    }
+    workers_.clear();
+    stopping_ = false;
+}
+
+// evaluate() waits for every worker before the next round, so none of
+// them ever misses one
+void LagrangianSolver::workerLoop() {
+    unsigned seen = 0;
+    unique_lock<mutex> lock(poolLock_);
+    for (;;) {
+        wake_.wait(lock, [&]() { return stopping_ || round_ != seen; });
+        if (stopping_) {
+            return;
+        }
+        seen = round_;
+        float lambda = roundLambda_;
+        lock.unlock();
+        evaluateRanges(lambda);
+        lock.lock();
+        if (--busy_ == 0) {
+            finished_.notify_one();
+        }
+    }
+}
+
+// same scheme as KnobStager::stage, every range writes its own knobs
+void LagrangianSolver::evaluateRanges(float lambda) {
+    unsigned num_ranges = rangeBegin_.size() - 1;
+    for (unsigned r = nextRange_++; r < num_ranges; r = nextRange_++) {
+        evaluateRange(r, lambda);
+    }
+}
+
+double LagrangianSolver::evaluate(float lambda, float budget, double &cost) {
+    unsigned num_ranges = rangeBegin_.size() - 1;
+    {
+        lock_guard<mutex> lock(poolLock_);
+        roundLambda_ = lambda;
+        nextRange_ = 0;
+        busy_ = workers_.size();
+        round_++;
+    }
+    wake_.notify_all();
+    evaluateRanges(lambda);
+    {
+        unique_lock<mutex> lock(poolLock_);
+        finished_.wait(lock, [&]() { return busy_ == 0; });
+    }
+    
+    double value = (double)lambda * budget;
+    cost = 0;
+    for (unsigned r = 0; r < num_ranges; r++) {
+        cost += rangeCost_[r];
+        value += rangeScore_[r];
+    }
+    return value;
+}
+
+bool LagrangianSolver::solve(float budget, Solution &sol) {
+    if (!prepared_) {
+        prepare();
+    }
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_sources = flat_->getDepSources();
+    const float *quality = flat_->getQualities();
+    auto start = chrono::steady_clock::now();
+    auto out_of_time = [&]() {
+        return timeLimit_ > 0 && chrono::duration<double>(chrono::steady_clock::now() - start).count() > timeLimit_;
+    };
+    
+    greedy_.solve(budget, sol);
+    if (flat_->getMinCost() > budget) {
+        sol = Solution();
+        sol.setBound(-INFINITY);
+        return true;
+    }
+    fill(mu_.begin(), mu_.end(), 0);
+    startWorkers();
+    
+    // the priced choices within budget are primal candidates: the best
+    // one meeting every dependency, else the one breaking the fewest rows
+    vector<unsigned> found;
+    double found_quality = -INFINITY;
+    size_t found_broken = SIZE_MAX;
+    double cost;
+    auto consider = [&]() {
+        if (cost > budget) {
+            return;
+        }
+        size_t broken = 0;
+        for (const Row &row : rows_) {
+            unsigned source = choice_[knob_of[dep_sources[row.begin]]];
+            broken += choice_[knob_of[row.sink]] == row.sink &&
+                      !binary_search(dep_sources + row.begin, dep_sources + row.end, source);
+        }
+        double q = 0;
+        for (unsigned i : choice_) {
+            q += quality[i];
+        }
+        if (broken < found_broken || (broken == 0 && q > found_quality)) {
+            found_broken = broken;
+            found_quality = broken == 0 ? q : -INFINITY;
+            found = choice_;
+        }
+    };
+    
+    // the higher lambda, the cheaper the levels chosen, so bisect for the
+    // lambda at which their cost meets the budget
+    unsigned evaluations = 1;
+    float lambda = 0, best_lambda = 0;
+    double bound = evaluate(0, budget, cost);
+    if (cost > budget) {
+        float lo = 0, hi = 1;
+        for (unsigned step = 0; step < 128; step++, evaluations++) {
+            double value = evaluate(hi, budget, cost);
+            if (value < bound) {
+                bound = value;
+                best_lambda = hi;
+            }
+            if (cost <= budget) {
+                break;
+            }
+            lo = hi;
+            hi *= 2;
+        }
+        consider();
+        for (unsigned step = 0; step < BISECTION_STEPS && !out_of_time(); step++, evaluations++) {
+            float mid = lo + (hi - lo) / 2;
+            if (mid <= lo || mid >= hi) {
+                break;
+            }
+            double value = evaluate(mid, budget, cost);
+            if (value < bound) {
+                bound = value;
+                best_lambda = mid;
+            }
+            if (cost > budget) {
+                lo = mid;
+            } else {
+                hi = mid;
+                consider();
+            }
+        }
+    } else {
+        consider();
+    }
+    lambda = best_lambda;
+    
+    // then lambda and the row prices together, stepping against the
+    // subgradient by the estimated distance to the best configuration
+    if (dualizeDeps_ && !rows_.empty()) {
+        vector<signed char> row_grad(rows_.size());
+        double scale = max(fabs(budget), 1.0f);
+        float theta = 2;
+        unsigned stall = 0;
+        for (unsigned it = 0; it < MAX_ITERATIONS && theta > 1e-6f && !out_of_time(); it++, evaluations++) {
+            double value = evaluate(lambda, budget, cost);
+            if (value < bound) {
+                bound = value;
+                stall = 0;
+            } else if (++stall >= STALL_ITERATIONS) {
+                theta /= 2;
+                stall = 0;
+            }
+            consider();
+    
+            // the budget row is scaled to 1, or its gradient would drown the rows'
+            double lambda_grad = (budget - cost) / scale;
+            double norm = lambda_grad * lambda_grad;
+            for (unsigned r = 0; r < rows_.size(); r++) {
+                const Row &row = rows_[r];
+                unsigned source = choice_[knob_of[dep_sources[row.begin]]];
+                int grad = (int)binary_search(dep_sources + row.begin, dep_sources + row.end, source) -
+                           (int)(choice_[knob_of[row.sink]] == row.sink);
+                row_grad[r] = grad;
+                norm += grad * grad;
+            }
+            double target = found_quality;
+            if (!sol.isEmpty()) {
+                target = max(target, (double)sol.getQuality());
+            }
+            if (isinf(target)) {
+                target = value - fabs(value) * 0.05 - 1;
+            }
+            if (norm == 0 || value - target <= 1e-6 * max(fabs(value), 1.0)) {
+                break;
+            }
+            double step = theta * (value - target) / norm;
+            lambda = max(0.0, lambda - step * lambda_grad / scale);
+            for (unsigned r = 0; r < rows_.size(); r++) {
+                if (row_grad[r] != 0) {
+                    mu_[r] = max(0.0, mu_[r] - step * row_grad[r]);
+                }
+            }
+        }
+    }
+    
+    stopWorkers();
+    
+    // the best priced choice, repaired if need be and climbed by greedy
+    // with what the budget has left
+    Solution climbed;
+    if (!found.empty() && greedy_.solveFrom(found, budget, climbed) &&
+        (sol.isEmpty() || climbed.getQuality() > sol.getQuality())) {
+        sol = climbed;
+    }
+    if (!sol.isEmpty()) {
+        bound = max(bound, (double)sol.getQuality());
+    }
+    sol.setBound(bound);
+    LOG_INFO("lagrange: " << evaluations << " evaluations, lambda " << lambda << ", bound " << bound);
+    return true;
+}
@@ -0,0 +1,86 @@
+#ifndef LAGRANGIANSOLVER_H
+#define LAGRANGIANSOLVER_H
+
+#include "FlatKDG.h"
+#include "GreedySolver.h"
+#include "Solution.h"
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// Lagrangian relaxation for graphs too large to search. The budget is
+// moved into the objective with a price lambda per unit of cost, and with
+// setDualizeDependencies(true) every dependency row (sink needs one of its
+// sources in a knob) gets a price mu too: choosing a source earns the mu of
+// the rows it is in, choosing a sink pays them. Left with one level per
+// knob and nothing else, each knob just takes its best priced level, all
+// knobs at once on setThreads() workers. Whatever the prices,
+//   L = lambda * budget + sum over knobs of the best priced level
+// bounds the optimum from above. lambda is first found by bisection on the
+// cost of the chosen levels; the row prices, when dualized, then follow by
+// subgradient steps on lambda and mu together.
+// The configuration returned is the best of GreedySolver's and of the
+// priced choices that happen to be feasible, climbed further by the greedy
+// steps, and its bound is the smallest L met, hence the gap.
+class LagrangianSolver {
+private:
+    struct Row { unsigned sink, begin, end; }; // a dependency row, see LpWriter
+    
+    FlatKDG *flat_;
+    GreedySolver greedy_;
+    bool prepared_;
+    unsigned threads_;
+    bool dualizeDeps_;
+    double timeLimit_; // seconds
+    
+    vector<Row> rows_;
+    vector<unsigned> sinkRowBegin_;    // rows of sink i: rows_[sinkRowBegin_[i] .. sinkRowBegin_[i + 1])
+    vector<unsigned> sourceRowsBegin_; // rows basic i is a source of
+    vector<unsigned> sourceRows_;
+    vector<unsigned> rangeBegin_;      // knob ranges evaluated by one worker at a time
+    
+    // prices and the levels they pick
+    vector<float> mu_;                 // per row
+    vector<float> score_;              // per basic node
+    vector<unsigned> choice_;          // per knob
+    vector<double> rangeCost_;         // per range, summed by evaluate()
+    vector<double> rangeScore_;
+    
+    // workers kept for a whole solve, woken once per evaluate()
+    vector<thread> workers_;
+    mutex poolLock_;
+    condition_variable wake_;
+    condition_variable finished_;
+    unsigned round_;                   // bumped by every evaluate()
+    unsigned busy_;                    // workers not done with the round yet
+    bool stopping_;
+    float roundLambda_;
+    atomic<unsigned> nextRange_;
+    
+    void prepare();
+    void startWorkers();
+    void stopWorkers();
+    void workerLoop();
+    void evaluateRanges(float lambda);  // take ranges until none is left
+    void evaluateRange(unsigned range, float lambda);
+    double evaluate(float lambda, float budget, double &cost); // L, with the cost of choice_
+    
+public:
+    static const unsigned BASICS_PER_RANGE = 1 << 14;
+    static const unsigned BISECTION_STEPS = 60;
+    static const unsigned MAX_ITERATIONS = 1000;  // subgradient steps
+    static const unsigned STALL_ITERATIONS = 20;  // without a better L before the step size halves
+    
+    LagrangianSolver(FlatKDG *flat);
+    ~LagrangianSolver();
+    void setThreads(unsigned threads);
+    void setDualizeDependencies(bool dualize);
+    void setTimeLimit(double seconds);            // 0 for none
+    bool solve(float budget, Solution &sol);
+};
+
+#endif
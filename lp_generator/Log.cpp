@@ -0,0 +1,72 @@
+#include "Log.h"
+#include <cstring>
+#include <streambuf>
+#include <unistd.h>
+
+using namespace std;
+
+// fixed size buffer in front of a file descriptor
+class LogBuffer : public streambuf {
+private:
+    char buf_[1 << 16];
+    int fd_;
+    
+    void drain() {
+        const char *p = pbase();
+        while (p < pptr()) {
+            ssize_t n = write(fd_, p, pptr() - p);
+            if (n <= 0) {
+                break; // nowhere to log to, drop it
+            }
+            p += n;
+        }
+        setp(buf_, buf_ + sizeof(buf_));
+    }
+    
+protected:
+    int overflow(int c) {
+        drain();
+        if (c != EOF) {
+            *pptr() = c;
+            pbump(1);
+        }
+        return c;
+    }
+    int sync() {
+        drain();
+        return 0;
+    }
+    
+public:
+    LogBuffer(int fd):fd_(fd) { setp(buf_, buf_ + sizeof(buf_)); }
+    ~LogBuffer() { drain(); }
+};
+
+int Log::level = LVL_QUIET;
+
+bool Log::setLevel(const char *name) {
+    static const char *names[] = {"quiet", "info", "debug", "trace"};
+    for (int lvl = LVL_QUIET; lvl <= LVL_TRACE; lvl++) {
+        if (strcmp(name, names[lvl]) == 0) {
+            level = lvl;
+            return true;
+        }
+    }
+    return false;
+}
+
+ostream &Log::stream() {
+    static LogBuffer buffer(STDERR_FILENO);
+    static ostream out(&buffer);
+    return out;
+}
+
+mutex &Log::getMutex() {
+    static mutex lock;
+    return lock;
+}
+
+void Log::flush() {
+    lock_guard<mutex> lock(getMutex());
+    stream().flush();
+}
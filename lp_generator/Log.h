@@ -0,0 +1,51 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <mutex>
+#include <ostream>
+
+using namespace std;
+
+// Log levels, each one includes the ones before it. Errors are always shown.
+enum LogLevel { LVL_QUIET = 0, LVL_INFO, LVL_DEBUG, LVL_TRACE };
+
+// Levels above this are compiled out entirely
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL LVL_TRACE
+#endif
+
+// Process wide, buffered log sink on stderr. Lines collect in a large buffer
+// which is written out when full, on flush() and at exit, so logging does not
+// cost a write syscall per line.
+class Log {
+public:
+    static int level;                             // current level, LVL_QUIET by default
+    
+    static bool setLevel(const char *name);       // quiet, info, debug or trace
+    static bool enabled(int lvl) { return lvl <= LOG_MAX_LEVEL && lvl <= level; }
+    static ostream &stream();                     // the buffered sink, lock mutex() around use
+    static mutex &getMutex();
+    static void flush();
+};
+
+// Log statements: the message is only evaluated when the level is enabled,
+// a disabled statement costs a single compare of a global.
+#define LOG_AT(lvl, msg)                                                       \
+do {                                                                           \
+if (Log::enabled(lvl)) {                                                       \
+lock_guard<mutex> log_lock_(Log::getMutex());                                  \
+Log::stream() << msg << '\n';                                                  \
+}                                                                              \
+} while (0)
+
+#define LOG_INFO(msg) LOG_AT(LVL_INFO, msg)
+#define LOG_DEBUG(msg) LOG_AT(LVL_DEBUG, msg)
+#define LOG_TRACE(msg) LOG_AT(LVL_TRACE, msg)
+
+#define LOG_ERROR(msg)                                                         \
+do {                                                                           \
+lock_guard<mutex> log_lock_(Log::getMutex());                                  \
+Log::stream() << msg << endl;                                                  \
+} while (0)
+
+#endif
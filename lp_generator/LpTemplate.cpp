@@ -0,0 +1,104 @@
+#include "LpTemplate.h"
+#include "Log.h"
+#include "LpWriter.h"
+#include <cstdio>
+#include <fcntl.h>
+#include <fstream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+LpTemplate::LpTemplate(string lp_path):lpPath_(lp_path), inputSize_(0), inputMtime_(0),
+    budgetOffset_(0), budgetWidth_(0), lpSize_(0), lpMtime_(0) {}
+
+string LpTemplate::getPath() { return lpPath_ + ".tpl"; }
+
+bool LpTemplate::getStamp(string input, uint64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (stat(input.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    size = st.st_size;
+    mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+bool LpTemplate::setInput(string input) {
+    input_ = input;
+    return getStamp(input, inputSize_, inputMtime_);
+}
+
+void LpTemplate::setModel(string model) { model_ = model; }
+
+void LpTemplate::setBudgetField(uint64_t offset, unsigned width) {
+    budgetOffset_ = offset;
+    budgetWidth_ = width;
+}
+
+// one line: version, input stamp, budget field, LP stamp, model, then the
+// input path
+bool LpTemplate::save() {
+    if (!getStamp(lpPath_, lpSize_, lpMtime_)) {
+        LOG_ERROR("could not stamp " << lpPath_);
+        return false;
+    }
+    string tmp = getPath() + ".tmp" + to_string(getpid());
+    ofstream out(tmp);
+    out << "lptemplate " << VERSION << " " << inputSize_ << " " << inputMtime_ << " "
+        << budgetOffset_ << " " << budgetWidth_ << " " << lpSize_ << " " << lpMtime_ << " " << model_ << " "
+        << input_ << "\n";
+    out.close();
+    if (!out || rename(tmp.c_str(), getPath().c_str()) != 0) {
+        LOG_ERROR("could not write LP template " << getPath());
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool LpTemplate::load() {
+    ifstream in(getPath());
+    string magic;
+    unsigned version = 0;
+    in >> magic >> version >> inputSize_ >> inputMtime_ >> budgetOffset_ >> budgetWidth_ >> lpSize_ >> lpMtime_
+       >> model_;
+    in.get();
+    getline(in, input_);
+    return in && magic == "lptemplate" && version == VERSION;
+}
+
+bool LpTemplate::matches(string input, string model) {
+    uint64_t size;
+    int64_t mtime;
+    return input == input_ && model == model_ && getStamp(input, size, mtime) && size == inputSize_ && mtime == inputMtime_;
+}
+
+bool LpTemplate::patchBudget(float budget) {
+    char field[LpWriter::BUDGET_WIDTH];
+    if ((budgetWidth_ != 0 && budgetWidth_ != LpWriter::BUDGET_WIDTH) || !LpWriter::formatBudget(budget, field)) {
+        return false;
+    }
+    
+    // the LP must still be exactly the file the template was taken from,
+    // not even rewritten to the same size since
+    uint64_t size;
+    int64_t mtime;
+    if (!getStamp(lpPath_, size, mtime) || size != lpSize_ || mtime != lpMtime_) {
+        return false;
+    }
+    // no level costs anything, the LP holds for any budget it can meet
+    if (budgetWidth_ == 0) {
+        return budget >= 0;
+    }
+    int fd = open(lpPath_.c_str(), O_WRONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = pwrite(fd, field, budgetWidth_, budgetOffset_) == (ssize_t)budgetWidth_;
+    close(fd);
+    // the patch moved the LP's modification time on, take it again
+    return ok && save();
+}
+
+void LpTemplate::remove() { unlink(getPath().c_str()); }
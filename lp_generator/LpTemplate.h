@@ -0,0 +1,44 @@
+#ifndef LPTEMPLATE_H
+#define LPTEMPLATE_H
+
+#include <cstdint>
+#include <string>
+
+using namespace std;
+
+// Where the budget sits in a written LP file, kept next to it in <lp>.tpl.
+// A later run that only changes the budget overwrites those few bytes in
+// place instead of building and writing the whole LP again. The input's
+// path, size and modification time, and the options the model was built
+// with, tell whether the LP is still current; the LP's own size and
+// modification time, whether it is still the file the field was found in.
+class LpTemplate {
+private:
+    string lpPath_;
+    string input_;
+    string model_; // options that change the LP besides the budget
+    uint64_t inputSize_;
+    int64_t inputMtime_; // nanoseconds
+    uint64_t budgetOffset_;
+    unsigned budgetWidth_;
+    uint64_t lpSize_;
+    int64_t lpMtime_;    // nanoseconds, taken again after every patch
+    
+    static bool getStamp(string input, uint64_t &size, int64_t &mtime);
+    
+public:
+    static const unsigned VERSION = 3;
+    
+    LpTemplate(string lp_path);
+    string getPath();                             // the .tpl file
+    bool setInput(string input);                  // false if it cannot be stamped (pipes)
+    void setModel(string model);                  // one word, no spaces
+    void setBudgetField(uint64_t offset, unsigned width); // width 0: the LP has no budget row
+    bool save();                                  // stamps the LP as it is now
+    bool load();                                  // false if missing or from another version
+    bool matches(string input, string model);     // the LP was written from this input as it is now
+    bool patchBudget(float budget);               // rewrite the budget in the LP file
+    void remove();
+};
+
+#endif
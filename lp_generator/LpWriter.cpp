@@ -0,0 +1,482 @@
+#include "LpWriter.h"
+#include "Log.h"
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/uio.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace std;
+
+/****** LpBuffer ******/
+
+LpBuffer::LpBuffer(size_t capacity):capacity_(capacity), used_(0), flushed_(0), fd_(-1) {
+    buf_ = (char *)malloc(capacity_);
+    if (buf_ == NULL) {
+        throw bad_alloc();
+    }
+}
+
+bool LpBuffer::open(string path) {
+    close();
+    fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    return fd_ >= 0;
+}
+
+bool LpBuffer::close() {
+    if (fd_ < 0) {
+        return true;
+    }
+    flush();
+    bool ok = (used_ == 0);
+    ::close(fd_);
+    fd_ = -1;
+    return ok;
+}
+
+void LpBuffer::flush() {
+    size_t done = 0;
+    while (fd_ >= 0 && done < used_) {
+        ssize_t n = write(fd_, buf_ + done, used_ - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            LOG_ERROR("could not write LP output");
+            break;
+        }
+        done += n;
+    }
+    memmove(buf_, buf_ + done, used_ - done);
+    used_ -= done;
+    flushed_ += done;
+}
+
+void LpBuffer::clear() {
+    used_ = 0;
+    flushed_ = 0;
+}
+
+void LpBuffer::makeRoom(size_t bytes) {
+    if (fd_ >= 0) {
+        flush();
+    }
+    if (capacity_ - used_ < bytes) {
+        while (capacity_ - used_ < bytes) {
+            capacity_ *= 2;
+        }
+        char *grown = (char *)realloc(buf_, capacity_);
+        if (grown == NULL) {
+            throw bad_alloc();
+        }
+        buf_ = grown;
+    }
+}
+
+void LpBuffer::put(string_view s) {
+    if (capacity_ - used_ < s.size()) makeRoom(s.size());
+    memcpy(buf_ + used_, s.data(), s.size());
+    used_ += s.size();
+}
+
+void LpBuffer::putUnsigned(uint64_t val) {
+    if (capacity_ - used_ < 20) makeRoom(20);
+    used_ = to_chars(buf_ + used_, buf_ + capacity_, val).ptr - buf_;
+}
+
+void LpBuffer::putFloat(float val) {
+    if (capacity_ - used_ < 32) makeRoom(32);
+    used_ = to_chars(buf_ + used_, buf_ + capacity_, val).ptr - buf_;
+}
+
+const char *LpBuffer::getData() { return buf_; }
+
+size_t LpBuffer::getSize() { return used_; }
+
+size_t LpBuffer::getOffset() { return flushed_ + used_; }
+
+LpBuffer::~LpBuffer() {
+    close();
+    free(buf_);
+}
+
+
+/****** LpWriter ******/
+
+static const char *FORMULATION_NAMES[] = {"binary", "onehot", "sos"};
+
+LpWriter::LpWriter(FlatKDG *flat):flat_(flat), budget_(0), formulation_(FORM_ONEHOT), threads_(1), budgetOffset_(0), size_(0) {}
+
+// padded in front, so the line still ends at the number
+bool LpWriter::formatBudget(float budget, char *field) {
+    char digits[BUDGET_WIDTH];
+    to_chars_result res = to_chars(digits, digits + BUDGET_WIDTH, budget);
+    if (res.ec != errc()) {
+        return false;
+    }
+    size_t len = res.ptr - digits;
+    memset(field, ' ', BUDGET_WIDTH - len);
+    memcpy(field + BUDGET_WIDTH - len, digits, len);
+    return true;
+}
+
+bool LpWriter::parseFormulation(const char *name, Formulation &form) {
+    for (int f = FORM_BINARY; f <= FORM_SOS; f++) {
+        if (strcmp(name, FORMULATION_NAMES[f]) == 0) {
+            form = (Formulation)f;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *LpWriter::getFormulationName(Formulation form) { return FORMULATION_NAMES[form]; }
+
+void LpWriter::setBudget(float budget) { budget_ = budget; }
+
+void LpWriter::setFormulation(Formulation form) { formulation_ = form; }
+
+void LpWriter::setThreads(unsigned threads) { threads_ = threads > 0 ? threads : 1; }
+
+// cut the knobs into ranges of about BASICS_PER_RANGE basic nodes
+void LpWriter::splitRanges() {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    unsigned num_knobs = flat_->getNumKnobs();
+    rangeBegin_.assign(1, 0);
+    for (unsigned k = 1; k < num_knobs; k++) {
+        if (knob_begin[k] - knob_begin[rangeBegin_.back()] >= BASICS_PER_RANGE) {
+            rangeBegin_.push_back(k);
+        }
+    }
+    rangeBegin_.push_back(num_knobs);
+}
+
+void LpWriter::genSection(LpBuffer &out, SectionGen gen) {
+    unsigned num_ranges = rangeBegin_.size() - 1;
+    if (threads_ <= 1 || num_ranges <= 1) {
+        (this->*gen)(out, 0, flat_->getNumKnobs());
+        return;
+    }
+    
+    // same scheme as KnobStager::stage: workers pull ranges off a counter,
+    // each range has its own buffer, and they are copied out in order
+    vector<LpBuffer *> parts(num_ranges);
+    atomic<unsigned> next(0);
+    auto work = [&]() {
+        for (unsigned r = next++; r < num_ranges; r = next++) {
+            parts[r] = new LpBuffer(BASICS_PER_RANGE * 32);
+            (this->*gen)(*parts[r], rangeBegin_[r], rangeBegin_[r + 1]);
+        }
+    };
+    vector<thread> workers;
+    for (unsigned t = 1; t < threads_ && t < num_ranges; t++) {
+        workers.push_back(thread(work));
+    }
+    work();
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    for (LpBuffer *part : parts) {
+        out.put(string_view(part->getData(), part->getSize()));
+        delete part;
+    }
+}
+
+// " + 10 S1_0", wrapping lines to keep them short for the solvers
+void LpWriter::putTerm(LpBuffer &out, float coef, unsigned basic, unsigned &on_line) {
+    if (on_line == TERMS_PER_LINE) {
+        out.put('\n');
+        on_line = 0;
+    }
+    out.put(coef < 0 ? " - " : " + ");
+    if (coef != 1 && coef != -1) {
+        out.putFloat(coef < 0 ? -coef : coef);
+        out.put(' ');
+    }
+    out.put(flat_->getBasicName(basic));
+    on_line++;
+}
+
+// one line per knob: + quality name ...
+void LpWriter::genObjectiveFunction(LpBuffer &out, unsigned first_knob, unsigned last_knob) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const float *quality = flat_->getQualities();
+    for (unsigned k = first_knob; k < last_knob; k++) {
+        unsigned on_line = 0;
+        for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+            if (quality[i] != 0) {
+                putTerm(out, quality[i], i, on_line);
+            }
+        }
+        if (on_line > 0) {
+            out.put('\n');
+        }
+    }
+}
+
+// one line per knob: + cost name ...
+void LpWriter::genBudgetConstraint(LpBuffer &out, unsigned first_knob, unsigned last_knob) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const float *cost = flat_->getCosts();
+    for (unsigned k = first_knob; k < last_knob; k++) {
+        unsigned on_line = 0;
+        for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+            if (cost[i] != 0) {
+                putTerm(out, cost[i], i, on_line);
+            }
+        }
+        if (on_line > 0) {
+            out.put('\n');
+        }
+    }
+}
+
+// a row per (sink, source knob): sink - source - source ... <= 0
+void LpWriter::genKnobConstraints(LpBuffer &out, unsigned first_knob, unsigned last_knob) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    for (unsigned i = knob_begin[first_knob]; i < knob_begin[last_knob]; i++) {
+        // sources are sorted, so each knob's sources are a contiguous run
+        for (unsigned e = dep_begin[i]; e < dep_begin[i + 1];) {
+            unsigned source_knob = knob_of[dep_sources[e]];
+            out.put(" dep_");
+            out.put(flat_->getBasicName(i));
+            out.put('_');
+            out.put(flat_->getKnobName(source_knob));
+            out.put(": ");
+            out.put(flat_->getBasicName(i));
+            unsigned on_line = 1;
+            for (; e < dep_begin[i + 1] && knob_of[dep_sources[e]] == source_knob; e++) {
+                putTerm(out, -1, dep_sources[e], on_line);
+            }
+            out.put(" <= 0\n");
+        }
+    }
+}
+
+// a row per knob: level + level ... = 1. A knob without levels gets
+// none, it could never be satisfied.
+void LpWriter::genChoiceConstraints(LpBuffer &out, unsigned first_knob, unsigned last_knob) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    for (unsigned k = first_knob; k < last_knob; k++) {
+        if (knob_begin[k] == knob_begin[k + 1]) {
+            continue;
+        }
+        out.put(" knob_");
+        out.put(flat_->getKnobName(k));
+        out.put(": ");
+        out.put(flat_->getBasicName(knob_begin[k]));
+        unsigned on_line = 1;
+        for (unsigned i = knob_begin[k] + 1; i < knob_begin[k + 1]; i++) {
+            putTerm(out, 1, i, on_line);
+        }
+        out.put(" = 1\n");
+    }
+}
+
+// a set per knob: name: S1:: level:weight ..., weights being the level order
+void LpWriter::genSosSets(LpBuffer &out, unsigned first_knob, unsigned last_knob) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    for (unsigned k = first_knob; k < last_knob; k++) {
+        if (knob_begin[k + 1] - knob_begin[k] < 2) {
+            continue;
+        }
+        out.put(" sos_");
+        out.put(flat_->getKnobName(k));
+        out.put(": S1::");
+        for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+            unsigned level = i - knob_begin[k];
+            if (level > 0 && level % TERMS_PER_LINE == 0) {
+                out.put('\n');
+            }
+            out.put(' ');
+            out.put(flat_->getBasicName(i));
+            out.put(':');
+            out.putUnsigned(level + 1);
+        }
+        out.put('\n');
+    }
+}
+
+// one line per knob: names ...
+void LpWriter::genBinaries(LpBuffer &out, unsigned first_knob, unsigned last_knob) {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    for (unsigned k = first_knob; k < last_knob; k++) {
+        for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+            out.put(' ');
+            out.put(flat_->getBasicName(i));
+            if ((i - knob_begin[k]) % TERMS_PER_LINE == TERMS_PER_LINE - 1) {
+                out.put('\n');
+            }
+        }
+        if ((knob_begin[k + 1] - knob_begin[k]) % TERMS_PER_LINE != 0) {
+            out.put('\n');
+        }
+    }
+}
+
+bool LpWriter::hasCosts() {
+    const float *cost = flat_->getCosts();
+    for (unsigned i = 0; i < flat_->getNumBasics(); i++) {
+        if (cost[i] != 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool LpWriter::checkBudget(float budget) {
+    char field[BUDGET_WIDTH];
+    if (!formatBudget(budget, field)) {
+        LOG_ERROR("budget " << budget << " does not fit the LP");
+        return false;
+    }
+    // without a budget row nothing would keep a negative budget infeasible
+    if (budget < 0 && !hasCosts()) {
+        LOG_ERROR("budget " << budget << " is below the cost of every configuration, 0");
+        return false;
+    }
+    return true;
+}
+
+bool LpWriter::generate(LpBuffer &out) {
+    splitRanges();
+    
+    // objective function
+    out.put("Maximize\n obj:\n");
+    genSection(out, &LpWriter::genObjectiveFunction);
+    
+    // constraints
+    out.put("Subject To\n");
+    
+    // first constraint: budget
+    char field[BUDGET_WIDTH];
+    if (!checkBudget(budget_)) {
+        return false;
+    }
+    budgetOffset_ = NO_BUDGET;
+    if (hasCosts()) {
+        out.put(" budget:\n");
+        genSection(out, &LpWriter::genBudgetConstraint);
+        out.put(" <= ");
+        formatBudget(budget_, field);
+        budgetOffset_ = out.getOffset();
+        out.put(string_view(field, BUDGET_WIDTH));
+        out.put('\n');
+    }
+    
+    // following constraints: node dependency
+    genSection(out, &LpWriter::genKnobConstraints);
+    
+    // one level per knob
+    if (formulation_ != FORM_BINARY) {
+        genSection(out, &LpWriter::genChoiceConstraints);
+    }
+    
+    // every variable picks a basic node or not
+    out.put("Binaries\n");
+    genSection(out, &LpWriter::genBinaries);
+    if (formulation_ == FORM_SOS) {
+        out.put("SOS\n");
+        genSection(out, &LpWriter::genSosSets);
+    }
+    
+    // end
+    out.put("End\n");
+    size_ = out.getOffset();
+    return true;
+}
+
+bool LpWriter::write(string path) {
+    LpBuffer out;
+    if (!checkBudget(budget_)) {
+        return false;                             // before the old file is truncated
+    }
+    if (!out.open(path)) {
+        LOG_ERROR("could not open " << path);
+        return false;
+    }
+    return generate(out) && out.close();
+}
+
+// writev() writes at most about 2 GB at a time and may stop early, so go
+// on from wherever it got to
+static bool writeAll(int fd, struct iovec *parts, int count) {
+    while (count > 0) {
+        ssize_t n = writev(fd, parts, count);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        for (; count > 0 && (size_t)n >= parts->iov_len; parts++, count--) {
+            n -= parts->iov_len;
+        }
+        if (count > 0) {
+            parts->iov_base = (char *)parts->iov_base + n;
+            parts->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+// The LP is only built once, in memory. Every file is then that text with
+// its own budget field, written out by a pool of threads_ workers.
+unsigned LpWriter::writeSweep(const vector<float> &budgets, const vector<string> &paths) {
+    LpBuffer text;
+    for (float budget : budgets) {
+        if (!checkBudget(budget)) {
+            return 0;
+        }
+    }
+    if (!generate(text)) {
+        return 0;
+    }
+    
+    // an LP without a budget row is the same text for every budget
+    const char *data = text.getData();
+    size_t field_at = budgetOffset_ == NO_BUDGET ? size_ : budgetOffset_;
+    size_t field_width = budgetOffset_ == NO_BUDGET ? 0 : BUDGET_WIDTH;
+    size_t field_end = field_at + field_width;
+    atomic<unsigned> next(0), written(0);
+    auto work = [&]() {
+        char field[BUDGET_WIDTH];
+        for (unsigned b = next++; b < budgets.size(); b = next++) {
+            formatBudget(budgets[b], field);
+            int fd = ::open(paths[b].c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            struct iovec parts[3] = {
+                {(void *)data, field_at},
+                {field, field_width},
+                {(void *)(data + field_end), size_ - field_end},
+            };
+            if (fd < 0 || !writeAll(fd, parts, 3)) {
+                LOG_ERROR("could not write " << paths[b]);
+            } else {
+                written++;
+            }
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    };
+    vector<thread> workers;
+    for (unsigned t = 1; t < threads_ && t < budgets.size(); t++) {
+        workers.push_back(thread(work));
+    }
+    work();
+    for (thread &worker : workers) {
+        worker.join();
+    }
+    return written;
+}
+
+uint64_t LpWriter::getBudgetOffset() { return budgetOffset_; }
+
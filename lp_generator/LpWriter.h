@@ -0,0 +1,108 @@
+#ifndef LPWRITER_H
+#define LPWRITER_H
+
+#include "FlatKDG.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Output buffer for LP text. Numbers and names are formatted straight into
+// one large, reused buffer; attached to a file it is written out in big
+// blocks whenever it fills up, otherwise it grows and keeps everything.
+class LpBuffer {
+private:
+    char *buf_;
+    size_t capacity_;
+    size_t used_;
+    size_t flushed_; // bytes already written out to the file
+    int fd_;
+    
+    void makeRoom(size_t bytes);
+    
+public:
+    static const size_t DEFAULT_CAPACITY = 4 << 20;
+    
+    LpBuffer(size_t capacity = DEFAULT_CAPACITY);
+    LpBuffer(const LpBuffer &) = delete;
+    bool open(string path);                       // write through to this file
+    bool close();                                 // flush and close the file
+    void flush();
+    void clear();                                 // drop the content of an in-memory buffer
+    
+    void put(char c) {
+        if (used_ == capacity_) makeRoom(1);
+        buf_[used_++] = c;
+    }
+    void put(string_view s);
+    void putUnsigned(uint64_t val);
+    void putFloat(float val);                     // shortest form that reads back exactly
+    
+    const char *getData();                        // content not flushed yet
+    size_t getSize();
+    size_t getOffset();                           // bytes produced so far, flushed or not
+    ~LpBuffer();
+};
+
+// What the LP says about the levels of a knob: nothing, every basic node is
+// a free binary; exactly one of them is chosen, a "= 1" row per knob (the
+// KDG's own model); or that plus an SOS1 set per knob for the solver.
+enum Formulation { FORM_BINARY = 0, FORM_ONEHOT, FORM_SOS };
+
+// Writes the LP of a compiled KDG in CPLEX LP format: maximize the summed
+// quality of the chosen basic nodes (one binary variable each, named after
+// the node) subject to the budget, and, for every sink and every knob it
+// depends on, "sink <= sum of its sources in that knob", plus the knob
+// rows and sets of the formulation. When no level costs anything the budget
+// row would have no terms, which the solvers reject, so it is left out.
+// Every section is produced knob by knob, for any range of knobs, so the
+// same text comes out whichever way the knobs are split up: with several
+// threads each range goes to its own buffer and the buffers are written
+// out in knob order.
+class LpWriter {
+private:
+    typedef void (LpWriter::*SectionGen)(LpBuffer &out, unsigned first_knob, unsigned last_knob);
+    
+    FlatKDG *flat_;
+    float budget_;
+    Formulation formulation_;
+    unsigned threads_;
+    uint64_t budgetOffset_; // where the budget was written, see LpTemplate; NO_BUDGET without a budget row
+    uint64_t size_;
+    vector<unsigned> rangeBegin_; // knob ranges handed to the workers
+    
+    void putTerm(LpBuffer &out, float coef, unsigned basic, unsigned &on_line);
+    void splitRanges();
+    void genSection(LpBuffer &out, SectionGen gen); // all knobs, on threads_ workers
+    bool hasCosts();                              // some level costs something, so there is a budget row
+    bool checkBudget(float budget);               // fits the field, and a model without costs fits it
+    bool generate(LpBuffer &out);                 // the whole LP
+    
+public:
+    static const unsigned TERMS_PER_LINE = 8;
+    static const unsigned BASICS_PER_RANGE = 4096;
+    static const unsigned BUDGET_WIDTH = 16;      // the budget is padded to this, so it can be patched
+    static constexpr uint64_t NO_BUDGET = UINT64_MAX;
+    
+    static bool formatBudget(float budget, char *field); // BUDGET_WIDTH chars, right aligned; false if too wide
+    static bool parseFormulation(const char *name, Formulation &form); // binary, onehot or sos
+    static const char *getFormulationName(Formulation form);
+    
+    LpWriter(FlatKDG *flat);
+    void setBudget(float budget);
+    void setFormulation(Formulation form);      // FORM_ONEHOT by default
+    void setThreads(unsigned threads);
+    void genObjectiveFunction(LpBuffer &out, unsigned first_knob, unsigned last_knob);
+    void genBudgetConstraint(LpBuffer &out, unsigned first_knob, unsigned last_knob); // terms only
+    void genKnobConstraints(LpBuffer &out, unsigned first_knob, unsigned last_knob);
+    void genChoiceConstraints(LpBuffer &out, unsigned first_knob, unsigned last_knob); // one level per knob
+    void genSosSets(LpBuffer &out, unsigned first_knob, unsigned last_knob);
+    void genBinaries(LpBuffer &out, unsigned first_knob, unsigned last_knob);
+    bool write(string path);                      // the whole LP file
+    unsigned writeSweep(const vector<float> &budgets, const vector<string> &paths); // one LP per budget, returns how many were written
+    uint64_t getBudgetOffset();                   // of the last file written, NO_BUDGET if it has no budget row
+};
+
+#endif
@@ -0,0 +1,80 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace std;
+
+MappedFile::MappedFile():data_(NULL), size_(0), mapped_(0) {}
+
+bool MappedFile::open(string path) {
+    close();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        ::close(fd);
+        return false;
+    }
+
+    // reserve a zeroed span one byte longer than the file (rounded up to a
+    // page), then map the file over its beginning. Whatever is left past EOF
+    // reads as zero, which gives the text its terminator without a copy.
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t size = st.st_size;
+    size_t mapped = (size / page + 1) * page;
+
+    void *base = mmap(NULL, mapped, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED) {
+        ::close(fd);
+        return false;
+    }
+    if (size > 0) {
+        void *text = mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0);
+        if (text == MAP_FAILED) {
+            munmap(base, mapped);
+            ::close(fd);
+            return false;
+        }
+        madvise(base, size, MADV_SEQUENTIAL);
+    }
+    ::close(fd); // the mapping keeps the file alive
+
+    data_ = (char *)base;
+    size_ = size;
+    mapped_ = mapped;
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_ != NULL) {
+        munmap(data_, mapped_);
+    }
+    data_ = NULL;
+    size_ = 0;
+    mapped_ = 0;
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&other) {
+    if (this != &other) {
+        close();
+        data_ = other.data_;
+        size_ = other.size_;
+        mapped_ = other.mapped_;
+        other.data_ = NULL;
+        other.size_ = 0;
+        other.mapped_ = 0;
+    }
+    return *this;
+}
+
+char *MappedFile::getData() { return data_; }
+
+size_t MappedFile::getSize() { return size_; }
+
+MappedFile::~MappedFile() { close(); }
@@ -0,0 +1,29 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+// Read-only memory mapping of a whole file.
+// The mapped text is always followed by at least one zero byte, so it can be
+// handed directly to parsers expecting a null terminated buffer (rapidxml).
+class MappedFile {
+private:
+    char *data_;
+    size_t size_;   // file size in bytes
+    size_t mapped_; // length of the mapping, a multiple of the page size
+
+public:
+    MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(MappedFile &&other);    // take over other's mapping
+    bool open(string path);                      // map the file, false if it is not a regular file
+    void close();
+    char *getData();
+    size_t getSize();
+    ~MappedFile();
+};
+
+#endif
@@ -0,0 +1,28 @@
+#include "NameTable.h"
+#include <cstring>
+
+using namespace std;
+
+NameTable::NameTable() { intern(""); }
+
+uint32_t NameTable::intern(string_view name) {
+    auto found = ids_.find(name);
+    if (found != ids_.end()) {
+        return found->second;
+    }
+    char *copy = (char *)chars_.allocate(name.size(), 1);
+    memcpy(copy, name.data(), name.size());
+    uint32_t id = names_.size();
+    names_.push_back(string_view(copy, name.size()));
+    ids_.emplace(names_.back(), id);
+    return id;
+}
+
+uint32_t NameTable::find(string_view name) {
+    auto found = ids_.find(name);
+    return found == ids_.end() ? NO_NAME : found->second;
+}
+
+string_view NameTable::getName(uint32_t id) { return names_[id]; }
+
+unsigned NameTable::getSize() { return names_.size(); }
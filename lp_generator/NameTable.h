@@ -0,0 +1,31 @@
+#ifndef NAMETABLE_H
+#define NAMETABLE_H
+
+#include "Arena.h"
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+// KDG-wide string interner: each distinct name is stored once and nodes
+// refer to it by a 32-bit id, so comparing names is comparing ids.
+// Id 0 is always the empty name.
+class NameTable {
+private:
+    Arena chars_;                  // name bytes, never moved once interned
+    vector<string_view> names_;    // id -> name
+    unordered_map<string_view, uint32_t> ids_; // name -> id
+    
+public:
+    static const uint32_t NO_NAME = UINT32_MAX;
+    
+    NameTable();
+    uint32_t intern(string_view name);            // id of name, adding it if new
+    uint32_t find(string_view name);              // id of name, NO_NAME if unknown
+    string_view getName(uint32_t id);
+    unsigned getSize();                           // number of distinct names
+};
+
+#endif
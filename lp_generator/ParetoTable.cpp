@@ -0,0 +1,220 @@
+#include "ParetoTable.h"
+#include "KnapsackDP.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <unistd.h>
+
+using namespace std;
+
+// Binary format, native byte order, laid out like FlatKDG's:
+//   ParetoHeader
+//   cost, quality, changeBegin, changeKnob, changeBasic, checkpoints
+// every section starting on an 8 byte boundary, sizes following from the
+// counts in the header. Bump PARETO_VERSION whenever the layout changes.
+static const char PARETO_MAGIC[8] = {'K', 'D', 'G', 'P', 'A', 'R', 'T', '\0'};
+static const uint32_t PARETO_VERSION = 2;
+static const uint32_t PARETO_BYTE_ORDER = 0x01020304;
+
+struct ParetoHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t numKnobs;
+    uint32_t numBasics;
+    uint32_t numPoints;
+    uint32_t numChanges;
+    uint32_t checkpointEvery;
+    uint32_t reserved;
+    uint64_t graphHash;
+    uint64_t fileSize;
+};
+
+static_assert(sizeof(ParetoHeader) % 8 == 0, "sections start 8 byte aligned");
+
+static size_t align8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+ParetoTable::ParetoTable():numKnobs_(0), numBasics_(0), numPoints_(0), numChanges_(0),
+    checkpointEvery_(CHECKPOINT_EVERY), graphHash_(0) {
+    ownChangeBegin_.assign(1, 0);
+    pointAtOwn();
+}
+
+void ParetoTable::pointAtOwn() {
+    cost_ = ownCost_.data();
+    quality_ = ownQuality_.data();
+    changeBegin_ = ownChangeBegin_.data();
+    changeKnob_ = ownChangeKnob_.data();
+    changeBasic_ = ownChangeBasic_.data();
+    checkpoints_ = ownCheckpoints_.data();
+}
+
+vector<pair<const void **, size_t> > ParetoTable::getSections() {
+    size_t num_checkpoints = (numPoints_ + checkpointEvery_ - 1) / checkpointEvery_;
+    return {
+        {(const void **)&cost_, numPoints_ * sizeof(double)},
+        {(const void **)&quality_, numPoints_ * sizeof(float)},
+        {(const void **)&changeBegin_, (numPoints_ + 1) * sizeof(unsigned)},
+        {(const void **)&changeKnob_, numChanges_ * sizeof(unsigned)},
+        {(const void **)&changeBasic_, numChanges_ * sizeof(unsigned)},
+        {(const void **)&checkpoints_, num_checkpoints * numKnobs_ * sizeof(unsigned)},
+    };
+}
+
+bool ParetoTable::build(FlatKDG *flat) {
+    vector<double> cost;
+    vector<float> quality;
+    vector<unsigned> last;
+    unsigned num_knobs = flat->getNumKnobs();
+    ownChangeBegin_.assign(1, 0);
+    ownChangeKnob_.clear();
+    ownChangeBasic_.clear();
+    ownCheckpoints_.clear();
+    
+    KnapsackDP dp(flat);
+    bool ok = dp.solveFrontier(cost, quality, [&](const vector<unsigned> &choice) {
+        if ((ownChangeBegin_.size() - 1) % CHECKPOINT_EVERY == 0) {
+            ownCheckpoints_.insert(ownCheckpoints_.end(), choice.begin(), choice.end());
+        } else {
+            for (unsigned k = 0; k < num_knobs; k++) {
+                if (choice[k] != last[k]) {
+                    ownChangeKnob_.push_back(k);
+                    ownChangeBasic_.push_back(choice[k]);
+                }
+            }
+        }
+        ownChangeBegin_.push_back(ownChangeKnob_.size());
+        last = choice;
+    });
+    
+    mapping_.close();
+    ownCost_ = move(cost);
+    ownQuality_ = move(quality);
+    numKnobs_ = num_knobs;
+    numBasics_ = flat->getNumBasics();
+    graphHash_ = flat->getHash();
+    numPoints_ = ok ? ownCost_.size() : 0;
+    numChanges_ = ownChangeKnob_.size();
+    checkpointEvery_ = CHECKPOINT_EVERY;
+    if (!ok) {
+        ownCost_.clear();
+        ownQuality_.clear();
+        ownChangeBegin_.assign(1, 0);
+        numChanges_ = 0;
+    }
+    pointAtOwn();
+    return ok;
+}
+
+bool ParetoTable::save(string path) {
+    ParetoHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PARETO_MAGIC, sizeof(PARETO_MAGIC));
+    header.version = PARETO_VERSION;
+    header.byteOrder = PARETO_BYTE_ORDER;
+    header.numKnobs = numKnobs_;
+    header.numBasics = numBasics_;
+    header.numPoints = numPoints_;
+    header.numChanges = numChanges_;
+    header.checkpointEvery = checkpointEvery_;
+    header.graphHash = graphHash_;
+    header.fileSize = sizeof(header);
+    for (auto &section : getSections()) {
+        header.fileSize += align8(section.second);
+    }
+    
+    // write aside and rename, as KDGCache::store does, so a lookup never
+    // maps a partial table
+    string tmp = path + ".tmp" + to_string(getpid());
+    ofstream out(tmp, ios::binary | ios::trunc);
+    out.write((const char *)&header, sizeof(header));
+    static const char padding[8] = {0};
+    for (auto &section : getSections()) {
+        out.write((const char *)*section.first, section.second);
+        out.write(padding, align8(section.second) - section.second);
+    }
+    out.close();
+    if (out.fail() || rename(tmp.c_str(), path.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ParetoTable::load(string path) {
+    MappedFile mapping;
+    if (!mapping.open(path) || mapping.getSize() < sizeof(ParetoHeader)) {
+        return false;
+    }
+    ParetoHeader header;
+    memcpy(&header, mapping.getData(), sizeof(header));
+    if (memcmp(header.magic, PARETO_MAGIC, sizeof(PARETO_MAGIC)) != 0 ||
+        header.version != PARETO_VERSION || header.byteOrder != PARETO_BYTE_ORDER ||
+        header.fileSize != mapping.getSize() || header.checkpointEvery == 0) {
+        return false;
+    }
+    
+    numKnobs_ = header.numKnobs;
+    numBasics_ = header.numBasics;
+    numPoints_ = header.numPoints;
+    numChanges_ = header.numChanges;
+    checkpointEvery_ = header.checkpointEvery;
+    graphHash_ = header.graphHash;
+    size_t offset = sizeof(header);
+    for (auto &section : getSections()) {
+        offset += align8(section.second);
+    }
+    if (offset != header.fileSize) {
+        numKnobs_ = numBasics_ = numPoints_ = numChanges_ = 0;
+        checkpointEvery_ = CHECKPOINT_EVERY;
+        graphHash_ = 0;
+        pointAtOwn();
+        return false;
+    }
+    
+    // point every view into the mapping, which the table then keeps
+    mapping_ = move(mapping);
+    offset = sizeof(header);
+    for (auto &section : getSections()) {
+        *section.first = mapping_.getData() + offset;
+        offset += align8(section.second);
+    }
+    return true;
+}
+
+unsigned ParetoTable::find(float budget) {
+    unsigned n = upper_bound(cost_, cost_ + numPoints_, budget) - cost_;
+    return n == 0 ? NONE : n - 1;
+}
+
+// the checkpoint at or before point, then the changes up to it
+void ParetoTable::getChoice(unsigned point, vector<unsigned> &choice) {
+    unsigned first = point / checkpointEvery_ * checkpointEvery_;
+    const unsigned *checkpoint = checkpoints_ + (size_t)(point / checkpointEvery_) * numKnobs_;
+    choice.assign(checkpoint, checkpoint + numKnobs_);
+    for (unsigned c = changeBegin_[first + 1]; c < changeBegin_[point + 1]; c++) {
+        choice[changeKnob_[c]] = changeBasic_[c];
+    }
+}
+
+bool ParetoTable::lookup(float budget, vector<unsigned> &choice) {
+    unsigned point = find(budget);
+    if (point == NONE) {
+        return false;
+    }
+    getChoice(point, choice);
+    return true;
+}
+
+unsigned ParetoTable::getNumPoints() { return numPoints_; }
+
+unsigned ParetoTable::getNumKnobs() { return numKnobs_; }
+
+unsigned ParetoTable::getNumBasics() { return numBasics_; }
+
+uint64_t ParetoTable::getGraphHash() { return graphHash_; }
+
+const double *ParetoTable::getCosts() { return cost_; }
+
+const float *ParetoTable::getQualities() { return quality_; }
@@ -0,0 +1,73 @@
+#ifndef PARETOTABLE_H
+#define PARETOTABLE_H
+
+#include "FlatKDG.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Every budget's optimal configuration of a KDG, computed once: the Pareto
+// frontier of (total cost, total quality) over the configurations meeting
+// every dependency, cheapest first (see KnapsackDP::solveFrontier). Along
+// it cost and quality both rise, so the best configuration within a budget
+// is the last point that fits, a binary search away.
+// Configurations are stored as the knobs that change from one point to the
+// next, with a full configuration every CHECKPOINT_EVERY points, so getting
+// one back replays at most that many steps. Like FlatKDG, the arrays are
+// views into the table's own storage or into a mapped file after load().
+// Basic nodes are numbered as in the FlatKDG the table was built from,
+// whose hash the table keeps to be checked against.
+class ParetoTable {
+private:
+    unsigned numKnobs_;
+    unsigned numBasics_;
+    unsigned numPoints_;
+    unsigned numChanges_;
+    unsigned checkpointEvery_;
+    uint64_t graphHash_;          // FlatKDG::getHash() of the graph built from
+    
+    // views
+    const double *cost_;          // exact sums, so no point within a budget is mistaken for one above it
+    const float *quality_;
+    const unsigned *changeBegin_; // numPoints + 1 offsets, the changes from the point before (none at checkpoints)
+    const unsigned *changeKnob_;
+    const unsigned *changeBasic_;
+    const unsigned *checkpoints_; // numKnobs basic nodes per checkpoint
+    
+    // storage of a built table
+    vector<double> ownCost_;
+    vector<float> ownQuality_;
+    vector<unsigned> ownChangeBegin_;
+    vector<unsigned> ownChangeKnob_;
+    vector<unsigned> ownChangeBasic_;
+    vector<unsigned> ownCheckpoints_;
+    
+    // storage of a loaded table
+    MappedFile mapping_;
+    
+    void pointAtOwn();
+    vector<pair<const void **, size_t> > getSections(); // (view, bytes) in file order
+    
+public:
+    static const unsigned CHECKPOINT_EVERY = 64;
+    static constexpr unsigned NONE = UINT32_MAX;
+    
+    ParetoTable();
+    bool build(FlatKDG *flat);                    // false if the frontier is too large, see KnapsackDP
+    bool save(string path);                       // write the binary format aside, then rename it to path
+    bool load(string path);                       // map a file written by save()
+    unsigned find(float budget);                  // best point within budget, NONE if nothing fits
+    void getChoice(unsigned point, vector<unsigned> &choice); // basic node per knob
+    bool lookup(float budget, vector<unsigned> &choice); // find() then getChoice(), false if nothing fits
+    unsigned getNumPoints();
+    unsigned getNumKnobs();
+    unsigned getNumBasics();
+    uint64_t getGraphHash();
+    const double *getCosts();
+    const float *getQualities();
+};
+
+#endif
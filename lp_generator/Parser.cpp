@@ -1,184 +1,795 @@
 #include "Parser.h"
+#include "Decode.h"
+#include "BranchAndBound.h"
+#include "GreedySolver.h"
+#include "KDGCache.h"
+#include "KnapsackDP.h"
+#include "KnobStager.h"
+#include "LagrangianSolver.h"
+#include "Log.h"
+#include "LpTemplate.h"
+#include "LpWriter.h"
+#include "MappedFile.h"
+#include "ParetoTable.h"
+#include "Presolve.h"
+#include "XmlPullReader.h"
+#include <charconv>
+#include <cctype>
+#include <cstring>
 #include <fstream>
-#include <iostream>
-#include <sstream>
+#include <iterator>
 
 using namespace std;
 using namespace rapidxml;
 
-Parser::Parser(string appName):graph_(new KDG(appName)), budget_(-1.), appName_(appName){};
+Parser::Parser(string appName):graph_(new KDG(appName)), budget_(-1.), appName_(appName), text_(NULL),
+    threads_(1), presolve_(false), reuseLp_(false), reduceDeps_(false), formulation_(FORM_ONEHOT),
+    nodeLimit_(0), timeLimit_(0), dualizeDeps_(false){};
+
+
+/****** ParseReport ******/
+
+ParseReport::ParseReport():count_(0) {}
+
+void ParseReport::add(string message) {
+    if (count_ < MAX_MESSAGES) {
+        messages_.push_back(message);
+    }
+    count_++;
+}
+
+unsigned ParseReport::getCount() { return count_; }
+
+vector<string> *ParseReport::getMessages() { return &messages_; }
+
+// the count always shows, the messages from --log-level info on
+void ParseReport::print() {
+    for (string &msg : messages_) {
+        LOG_INFO(msg);
+    }
+    if (count_ > messages_.size()) {
+        LOG_INFO("... " << count_ - messages_.size() << " more");
+    }
+    LOG_ERROR(count_ << " problem(s) found in the input");
+}
+
+
+// the XML is parsed non-destructively, so names and values are views into
+// the input buffer which are NOT null terminated: always go through the sizes
+static string_view xmlValue(xml_base<> *node) {
+    return string_view(node->value(), node->value_size());
+}
+
+// map the file read-only so it can be parsed in place. Inputs that cannot be
+// mapped (pipes, special files) are read into a single buffer instead.
+// Either way the returned text is null terminated; NULL if unreadable.
+static char *readInput(string infile, MappedFile &mapping, string &content, size_t &size) {
+    if (mapping.open(infile)) {
+        size = mapping.getSize();
+        return mapping.getData();
+    }
+    ifstream in(infile, ios::binary);
+    if (!in) {
+        return NULL;
+    }
+    content.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    size = content.size();
+    return &content[0];
+}
+
+// with a cache directory set, look the input up by content. On a miss the
+// key is kept so storeCached() can save the graph once it is built.
+bool Parser::loadCached(const char *text, size_t size, string kind, string &key) {
+    if (cacheDir_.empty()) {
+        return false;
+    }
+    // a reduced graph is another graph, cached apart
+    key = KDGCache::getKey(text, size, reduceDeps_ ? kind + ",reduced" : kind, cacheSource_);
+    return KDGCache(cacheDir_).load(key, cacheSource_, graph_);
+}
+
+// inputs with problems are not cached, so the report shows up on every run
+void Parser::storeCached(string key) {
+    if (!key.empty() && report_.getCount() == 0) {
+        KDGCache(cacheDir_).store(key, cacheSource_, graph_);
+    }
+}
 
 // set any defined basic node fields to their correspondding XML val
 void Parser::getBasicNodeInfo(xml_node<> *xml_bnode, Basic *basic) {
-    string n_name, n_cost, f_name;
-    float cost;
-    float quality;
-    
     for (xml_node<> *fields = xml_bnode->first_node(); fields;
          fields = fields->next_sibling()) {
         
-        if (fields->name() == NULL) {
+        if (fields->name_size() == 0) {
             continue;
         }
-        string f_name = fields->name();
-        
-        if (f_name.compare("nodename") == 0) {
-            if (fields->value() != NULL) {
-                basic->setName(fields->value());
-                cout << "found node name: " << fields->value() << endl;
-            }
-        } else if (f_name.compare("cost") == 0) {
-            try {
-                cost = stof(fields->value());
-                cout << "found node cost: " << fields->value() << endl;
-            } catch (exception e) { // either out of range or invalid arg
-                cost = 0;
-            }
-            basic->setCost(cost);
-        } else if (f_name.compare("quality") == 0) {
-            try {
-                quality = stof(fields->value());
-                cout << "found node quality: " << fields->value() << endl;
-            } catch (exception e) { // either out of range or invalid arg
-                quality = 0;
-            }
-            basic->setQuality(quality);
-        } else if (f_name.compare("and") == 0) {
-            string source_name = fields->value();
-            cout << "found And edge with source: " << source_name << endl;
+        setBasicField(basic, string_view(fields->name(), fields->name_size()), xmlValue(fields),
+                      fields->value() - text_);
+    }
+}
+
+// set one basic node field from its XML text, offset is where the text
+// sits in the input (for the report)
+void Parser::setBasicField(Basic *basic, string_view field, string_view value, size_t offset) {
+    float val;
+    
+    if (field == "nodename") {
+        if (!value.empty()) {
+            basic->setName(value);
+            LOG_TRACE("found node name: " << basic->getName());
+        }
+    } else if (field == "cost" || field == "quality") {
+        bool is_cost = (field == "cost");
+        if (decodeFloat(value.data(), value.data() + value.size(), val)) {
+            LOG_TRACE("found node " << (is_cost ? "cost: " : "quality: ") << val);
+        } else { // either out of range or invalid, counts as 0
+            val = 0;
+            report_.add("offset " + to_string(offset) + ": bad " + string(field) + " '" +
+                        string(value) + "'");
+        }
+        if (is_cost) {
+            basic->setCost(val);
+        } else {
+            basic->setQuality(val);
         }
+    } else if (field == "and") {
+        // sources often come later in the file than their sinks, so only
+        // note the edge here; resolveDependencies() wires it up
+        LOG_TRACE("found And edge with source: " << value);
+        uint32_t source = graph_->getNames()->intern(value);
+        pendingEdges_.push_back(make_pair(basic, source));
     }
 }
 
 // Go through XML format RSDG build data structure
 void Parser::genKDGwithXML(string infile) {
+    input_ = infile;
     
     // temporary macros for readability
 #define FOR_EACH_knob_node(root_node)                                           \
 for (xml_node<> *knob_node = root_node->first_node("knob"); knob_node;      \
 knob_node = knob_node->next_sibling("knob"))
-    cout<<endl;
     
 #define FOR_EACH_LEVEL_NODE(knob_node)                                          \
 for (xml_node<> *level_node = knob_node->first_node("knoblayer");          \
 level_node; level_node = level_node->next_sibling("knoblayer"))
-    cout<<endl;
     
 #define FOR_EACH_BASIC_NODE(level_node)                                        \
 for (xml_node<> *basic_node = level_node->first_node("basicnode");           \
 basic_node; basic_node = basic_node->next_sibling("basicnode"))
-    cout<<endl;
     
     // Read in the xml list
+    MappedFile mapping;
     string content;
-    stringstream buffer;
+    string cache_key;
+    size_t size;
+    char *text = readInput(infile, mapping, content, size);
     xml_document<> doc;
-    ifstream xml_file;
     Knob *cur_knob = NULL;
     Level *cur_level = NULL;
     
     unsigned short level = 0; // Level index
     
-    try {
-        // xml_file.open(infile);
-        xml_file.open(infile);
-    } catch (ios_base::failure fail) {
-        // something went wrong
-        cout << "Could not open file " << infile << endl;
-        cout << fail.what() << endl;
+    if (text == NULL) {
+        LOG_ERROR("Could not open file " << infile);
+        return;
+    }
+    if (loadCached(text, size, "xml", cache_key)) {
         return;
     }
     
-    buffer << xml_file.rdbuf();
-    xml_file.close();
+    // knobs are independent until dependencies get resolved, so with
+    // several threads they are parsed apart and merged back in order
+    if (threads_ > 1) {
+        if (mergeStagedKnobs(text, size, infile)) {
+            resolveDependencies();
+            graph_->freeze(reduceDeps_);
+            storeCached(cache_key);
+        }
+        return;
+    }
     
-    content = (buffer.str()); // save buffer in string
-    doc.parse<0>(&content[0]);
+    // parse_fastest never writes into the text, so the mapping stays clean
+    try {
+        doc.parse<parse_fastest>(text);
+        text_ = text;
+    } catch (parse_error &err) {
+        LOG_ERROR("Could not parse XML file " << infile << ": " << err.what());
+        return;
+    }
     
     // Whole Doc ...
     xml_node<> *root_node = doc.first_node(); // resource tag...
     
     if (root_node == NULL) {
-        cout << "Could not begin parsing XML file. Possibly wrong format" << endl;
+        LOG_ERROR("Could not begin parsing XML file. Possibly wrong format");
+        return;
     }
     
     // get each service tag node saved in xml_node<> knob
     FOR_EACH_knob_node(root_node) {
         level = 0;
         
-        string knob_name = knob_node->first_node("knobname")->value();
+        xml_node<> *knob_name_node = knob_node->first_node("knobname");
+        string_view knob_name = knob_name_node ? xmlValue(knob_name_node) : "";
         
-        if (knob_name.compare("") != 0) {
-            cout << "knob name " << knob_name << endl;
+        if (!knob_name.empty()) {
+            LOG_DEBUG("knob name " << knob_name);
         }
         
-        cur_knob = new Knob(knob_name);
+        cur_knob = graph_->newKnob(knob_name);
         
         // get each servicelayer tag node save in xml_node<> level_node
         FOR_EACH_LEVEL_NODE(knob_node) {
             
-            string name = knob_name + "_" + to_string(level);
-            cout << "getting to level: " << level << endl;
+            LOG_TRACE("getting to level: " << level);
             level++;
-            cur_level = new Level(level);
+            cur_level = graph_->newLevel(level);
             cur_knob->addLevelNode(cur_level);
             
             // get each basic node save in xml_node<> basic_node
             FOR_EACH_BASIC_NODE(level_node) {
-                Basic *basic = new Basic("");
+                Basic *basic = graph_->newBasic("");
                 getBasicNodeInfo(basic_node, basic);
-                cout << "finished a basic_node: " << basic->getName() << endl << endl;
+                cur_level->addBasicNode(basic);
+                LOG_TRACE("finished a basic_node: " << basic->getName());
             }
         }
+        
+        // the knob is complete, hand it to the graph which indexes its nodes
+        graph_->addKnob(cur_knob);
     }
+    resolveDependencies();
+    graph_->freeze(reduceDeps_);
+    text_ = NULL;
+    storeCached(cache_key);
 }
 
-string Parser::genObjectiveFunction(){
-    // generate the obj func
-    return "I'm a dummy Objective Function";
+// Same as genKDGwithXML, but pulling the XML through a fixed size buffer
+// and building each node as its element goes by, so no DOM (nor the whole
+// file) is ever held in memory. Input is not looked up in the cache, that
+// would need a pass over the whole file first.
+void Parser::genKDGwithXMLStream(string infile) {
+    input_ = infile;
+    XmlPullReader reader;
+    Knob *cur_knob = NULL;
+    Level *cur_level = NULL;
+    Basic *cur_basic = NULL;
+    string field;      // innermost open element, the one text belongs to
+    unsigned depth = 0;
+    int level = 0;     // Level index
+    
+    if (!reader.open(infile)) {
+        LOG_ERROR("Could not open file " << infile);
+        return;
+    }
+    
+    for (;;) {
+        XmlPullReader::Event event = reader.next();
+        
+        if (event == XmlPullReader::DONE) {
+            // a truncated file ends with elements (and maybe a knob) still open
+            if (depth != 0 || cur_knob != NULL) {
+                LOG_ERROR("Could not parse XML file " << infile << ": unexpected end of data, "
+                          << depth << " element(s) left open");
+                return;
+            }
+            break;
+        } else if (event == XmlPullReader::ERROR) {
+            LOG_ERROR("Could not parse XML file " << infile << ": " << reader.getError());
+            return;
+        } else if (event == XmlPullReader::START) {
+            depth++;
+            string_view name = reader.getName();
+            field.assign(name.data(), name.size());
+            
+            // resource (depth 1) / knob / knoblayer / basicnode
+            if (depth == 2 && name == "knob") {
+                cur_knob = graph_->newKnob("");
+                level = 0;
+            } else if (depth == 3 && name == "knoblayer" && cur_knob != NULL) {
+                LOG_TRACE("getting to level: " << level);
+                level++;
+                cur_level = graph_->newLevel(level);
+                cur_knob->addLevelNode(cur_level);
+            } else if (depth == 4 && name == "basicnode" && cur_level != NULL) {
+                cur_basic = graph_->newBasic("");
+                cur_level->addBasicNode(cur_basic);
+            }
+        } else if (event == XmlPullReader::END) {
+            if (depth == 0) {
+                LOG_ERROR("Could not parse XML file " << infile << ": unbalanced </"
+                          << reader.getName() << ">");
+                return;
+            }
+            depth--;
+            field.clear();
+            
+            if (depth == 1 && reader.getName() == "knob" && cur_knob != NULL) {
+                // the knob is complete, hand it to the graph which indexes its nodes
+                graph_->addKnob(cur_knob);
+                cur_knob = NULL;
+                cur_level = NULL;
+            } else if (depth == 2 && reader.getName() == "knoblayer") {
+                cur_level = NULL;
+            } else if (depth == 3 && reader.getName() == "basicnode" && cur_basic != NULL) {
+                LOG_TRACE("finished a basic_node: " << cur_basic->getName());
+                cur_basic = NULL;
+            }
+        } else if (event == XmlPullReader::TEXT) {
+            if (depth == 3 && field == "knobname" && cur_knob != NULL) {
+                cur_knob->setName(reader.getText());
+                LOG_DEBUG("knob name " << cur_knob->getName());
+            } else if (depth == 5 && cur_basic != NULL) {
+                setBasicField(cur_basic, field, reader.getText(), reader.getOffset());
+            }
+        }
+    }
+    
+    resolveDependencies();
+    graph_->freeze(reduceDeps_);
 }
 
-string Parser::genbudgetConstraint(){
-    // generate the obj func
-    return "I'm a dummy budget constraint <= "+to_string(budget_);
+// parse the knobs of an XML input on threads_ workers (see KnobStager) and
+// replay what they staged into the graph, in input order, so the result is
+// the same as the single threaded walk. False if the input is broken.
+bool Parser::mergeStagedKnobs(const char *text, size_t size, string infile) {
+    KnobStager stager(text, size);
+    string error;
+    if (!stager.findKnobs(error)) {
+        LOG_ERROR("Could not parse XML file " << infile << ": " << error);
+        return false;
+    }
+    stager.stage(threads_);
+    LOG_INFO("parsed " << stager.getNumKnobs() << " knobs on " << threads_ << " threads");
+    
+    Knob *cur_knob = NULL;
+    Level *cur_level = NULL;
+    Basic *cur_basic = NULL;
+    int level = 0; // Level index
+    
+    for (StagedBatch &batch : *stager.getBatches()) {
+        for (StagedField &field : batch.fields) {
+            switch (field.kind) {
+            case StagedField::KNOB:
+                if (cur_knob != NULL) {
+                    graph_->addKnob(cur_knob);
+                }
+                LOG_DEBUG("knob name " << field.text);
+                cur_knob = graph_->newKnob(field.text);
+                level = 0;
+                break;
+            case StagedField::LEVEL:
+                level++;
+                cur_level = graph_->newLevel(level);
+                cur_knob->addLevelNode(cur_level);
+                break;
+            case StagedField::BASIC:
+                cur_basic = graph_->newBasic("");
+                cur_level->addBasicNode(cur_basic);
+                break;
+            case StagedField::NAME:
+                if (!field.text.empty()) {
+                    cur_basic->setName(field.text);
+                }
+                break;
+            case StagedField::COST:
+            case StagedField::QUALITY: {
+                bool is_cost = (field.kind == StagedField::COST);
+                if (!field.ok) { // either out of range or invalid, counts as 0
+                    field.val = 0;
+                    report_.add("offset " + to_string(field.text.data() - text) + ": bad " +
+                                (is_cost ? "cost" : "quality") + " '" + string(field.text) + "'");
+                }
+                if (is_cost) {
+                    cur_basic->setCost(field.val);
+                } else {
+                    cur_basic->setQuality(field.val);
+                }
+                break;
+            }
+            case StagedField::AND:
+                pendingEdges_.push_back(make_pair(cur_basic, graph_->getNames()->intern(field.text)));
+                break;
+            }
+        }
+        if (!batch.error.empty()) {
+            LOG_ERROR("Could not parse XML file " << infile << ": offset " << batch.errorOffset
+                      << ": " << batch.error);
+            return false;
+        }
+    }
+    if (cur_knob != NULL) {
+        graph_->addKnob(cur_knob);
+    }
+    return true;
 }
 
-string Parser::genKnobConstraints(){
-    // generate the obj func
-    return "I'm a dummy knob constraints";
+// second pass over the edges: every node is in the graph by now, so each
+// source is a single lookup by name id
+void Parser::resolveDependencies() {
+    unsigned dangling = 0;
+    for (auto &edge : pendingEdges_) {
+        Basic *source = graph_->getBasicFromNameId(edge.second);
+        if (source == NULL) {
+            report_.add("dangling dependency " + string(edge.first->getName()) + " <- " +
+                        string(graph_->getNames()->getName(edge.second)) + ": no such node");
+            dangling++;
+            continue;
+        }
+        edge.first->addDependency(source);
+    }
+    LOG_INFO("resolved " << pendingEdges_.size() - dangling << " dependencies, "
+             << dangling << " dangling");
+    pendingEdges_.clear();
+    pendingEdges_.shrink_to_fit();
 }
 
-string Parser::genBinaries(){
-    // generate the list of binaries
-    return "I'm a dummy binary constraints";
-}
+/****** .desc front-end ******/
 
-void Parser::setBudget(float budget){
-    budget_ = budget;
+// a cursor over one line of the description
+struct DescLine {
+    const char *p;
+    const char *end;
+    
+    void skipSpaces() {
+        while (p < end && isspace((unsigned char)*p)) p++;
+    }
+    bool eat(char c) {
+        skipSpaces();
+        if (p < end && *p == c) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+    // a token ends at whitespace or at any of the stop characters
+    string token(const char *stops) {
+        skipSpaces();
+        const char *start = p;
+        while (p < end && !isspace((unsigned char)*p) && strchr(stops, *p) == NULL) p++;
+        return string(start, p - start);
+    }
+    bool number(float &val) {
+        skipSpaces();
+        from_chars_result res = from_chars(p, end, val);
+        if (res.ec != errc() || !isfinite(val)) { // same rule as decodeFloat
+            return false;
+        }
+        p = res.ptr;
+        return true;
+    }
+};
+
+// "S2.0" -> the basic node of level 0 of knob S2
+static Basic *descBasic(KDG *graph, string ref) {
+    size_t dot = ref.rfind('.');
+    if (dot == string::npos || dot + 1 == ref.size()) {
+        return NULL;
+    }
+    Knob *knob = graph->getKnobFromName(ref.substr(0, dot));
+    if (knob == NULL) {
+        return NULL;
+    }
+    unsigned long lvl;
+    ArenaVector<Level *> *levels = knob->getLevelNodes();
+    if (!decodeUnsigned(ref.data() + dot + 1, ref.data() + ref.size(), lvl) ||
+        lvl >= levels->size()) {
+        return NULL;
+    }
+    return (*levels)[lvl]->getBasicNodes()->front();
 }
 
-void Parser::writeLp(string outfile_dir) {
-    ofstream out(outfile_dir+ appName_+".lp");
-    // objective functions
-    out << "Maximize" << endl;
-    
-    out << genObjectiveFunction() << endl;
+// knob line: S1 [(10-10),(20-20),...], one (cost-quality) pair per level
+static Knob *parseKnobLine(DescLine line, KDG *graph) {
+    string knob_name = line.token("[");
+    if (knob_name.empty() || !line.eat('[')) {
+        return NULL;
+    }
     
-    // constraints
-    out << endl << "Subject To" << endl;
+    Knob *knob = graph->newKnob(knob_name);
+    unsigned level = 0;
+    do {
+        float cost, quality;
+        if (!line.eat('(') || !line.number(cost) || !line.eat('-') ||
+            !line.number(quality) || !line.eat(')')) {
+            return NULL;
+        }
+        Basic *basic = graph->newBasic(knob_name + "_" + to_string(level));
+        basic->setCost(cost);
+        basic->setQuality(quality);
+        level++;
+        Level *lvl = graph->newLevel(level);
+        lvl->addBasicNode(basic);
+        knob->addLevelNode(lvl);
+    } while (line.eat(','));
     
-    // first constraint: budget
-    out << genbudgetConstraint() << endl;
+    if (!line.eat(']')) {
+        return NULL; // the partial knob stays in the arena, unreferenced
+    }
+    return knob;
+}
+
+// dependency line: S2.0 <- [S1.0,S1.1], the sink needs one of the sources
+static bool parseDepLine(DescLine line, KDG *graph) {
+    Basic *sink = descBasic(graph, line.token("<"));
+    if (sink == NULL || !line.eat('<') || !line.eat('-') || !line.eat('[')) {
+        return false;
+    }
+    vector<Basic *> sources;
+    do {
+        Basic *source = descBasic(graph, line.token(",]"));
+        if (source == NULL) {
+            return false;
+        }
+        sources.push_back(source);
+    } while (line.eat(','));
+    if (!line.eat(']')) {
+        return false;
+    }
+    for (Basic *source : sources) {
+        sink->addDependency(source);
+    }
+    return true;
+}
+
+// Go through a .desc description and build the KDG in a single pass,
+// without the intermediate XML produced by xml_generator/rapid.py
+void Parser::genKDGwithDesc(string infile) {
+    input_ = infile;
+    MappedFile mapping;
+    string content;
+    string cache_key;
+    size_t size;
+    const char *text = readInput(infile, mapping, content, size);
     
-    // following constraints: node dependency
-    out << genKnobConstraints() << endl;
+    if (text == NULL) {
+        LOG_ERROR("Could not open file " << infile);
+        return;
+    }
+    if (loadCached(text, size, "desc", cache_key)) {
+        return;
+    }
     
-    // generals
-    out << endl << "Generals" << endl;
+    enum { NAME, NONE, KNOBS, DEPENDENCIES } section = NAME;
+    unsigned line_num = 0;
     
-    out << genBinaries() <<endl;
+    for (const char *p = text; *p != '\0';) {
+        const char *eol = strchr(p, '\n');
+        if (eol == NULL) {
+            eol = p + strlen(p);
+        }
+        DescLine line = {p, eol};
+        p = (*eol == '\n') ? eol + 1 : eol;
+        line_num++;
+        
+        line.skipSpaces();
+        while (line.end > line.p && isspace((unsigned char)line.end[-1])) line.end--;
+        if (line.p == line.end) {
+            continue;
+        }
+        
+        string text_line(line.p, line.end - line.p);
+        if (section == NAME) {
+            // first line is the application name
+            LOG_INFO("desc for application " << text_line);
+            section = NONE;
+        } else if (text_line.compare("<Knobs>") == 0) {
+            section = KNOBS;
+        } else if (text_line.compare("<Dependencies>") == 0) {
+            section = DEPENDENCIES;
+        } else if (section == KNOBS) {
+            Knob *knob = parseKnobLine(line, graph_);
+            if (knob == NULL || graph_->getKnobFromName(knob->getName()) != NULL) {
+                report_.add(infile + ":" + to_string(line_num) + ": bad knob line: " + text_line);
+                continue;
+            }
+            graph_->addKnob(knob);
+        } else if (section == DEPENDENCIES) {
+            if (!parseDepLine(line, graph_)) {
+                report_.add(infile + ":" + to_string(line_num) + ": bad dependency line: " + text_line);
+            }
+        } else {
+            report_.add(infile + ":" + to_string(line_num) + ": line outside of any section: " + text_line);
+        }
+    }
+    graph_->freeze(reduceDeps_);
+    storeCached(cache_key);
+}
+
+KDG *Parser::getKDG(){
+    return graph_;
+}
+
+ParseReport *Parser::getReport(){
+    return &report_;
+}
+
+void Parser::setCacheDir(string dir){
+    cacheDir_ = dir;
+}
+
+void Parser::setThreads(unsigned threads){
+    threads_ = threads > 0 ? threads : 1;
+}
+
+void Parser::setPresolve(bool presolve){
+    presolve_ = presolve;
+}
+
+void Parser::setReuseLp(bool reuse){
+    reuseLp_ = reuse;
+}
+
+void Parser::setReduceDependencies(bool reduce){
+    reduceDeps_ = reduce;
+}
+
+void Parser::setFormulation(Formulation form){
+    formulation_ = form;
+}
+
+string Parser::getModel(){
+    return string(LpWriter::getFormulationName(formulation_)) + (presolve_ ? ",presolve" : "")
+        + (reduceDeps_ ? ",reduced" : "");
+}
+
+void Parser::presolve(){
+    if (!presolve_ || !graph_->isFrozen()) {
+        return;
+    }
+    Presolve presolver(graph_->getFlat());
+    presolver.run();
+    presolver.print();
+}
+
+bool Parser::solve(string method, Solution &sol){
+    if (!graph_->isFrozen()) {
+        LOG_ERROR("no graph to solve for " << appName_);
+        return false;
+    }
+    FlatKDG *flat = graph_->getFlat();
+    if (method == "dp") {
+        KnapsackDP dp(flat);
+        return dp.solve(budget_, sol);
+    }
+    if (method == "bnb") {
+        BranchAndBound bnb(flat);
+        bnb.setNodeLimit(nodeLimit_);
+        bnb.setTimeLimit(timeLimit_);
+        return bnb.solve(budget_, sol);
+    }
+    if (method == "greedy") {
+        GreedySolver greedy(flat);
+        return greedy.solve(budget_, sol);
+    }
+    if (method == "lagrange") {
+        LagrangianSolver lagrange(flat);
+        lagrange.setThreads(threads_);
+        lagrange.setDualizeDependencies(dualizeDeps_);
+        lagrange.setTimeLimit(timeLimit_);
+        return lagrange.solve(budget_, sol);
+    }
+    if (method == "pareto") {
+        // straight from a table written by writePareto
+        ParetoTable table;
+        if (!table.load(paretoTable_)) {
+            LOG_ERROR("cannot read the pareto table " << paretoTable_);
+            return false;
+        }
+        if (table.getNumKnobs() != flat->getNumKnobs() || table.getNumBasics() != flat->getNumBasics() ||
+            table.getGraphHash() != flat->getHash()) {
+            LOG_ERROR(paretoTable_ << " was written for another graph than " << appName_);
+            return false;
+        }
+        vector<unsigned> choice;
+        sol = Solution();
+        if (table.lookup(budget_, choice)) {
+            sol.setChoice(flat, choice);
+            sol.setBound(sol.getQuality());
+        }
+        return true;
+    }
+    LOG_ERROR("unknown solver " << method);
+    return false;
+}
+
+bool Parser::writePareto(string path){
+    if (!graph_->isFrozen()) {
+        LOG_ERROR("no graph to build a pareto table for " << appName_);
+        return false;
+    }
+    ParetoTable table;
+    if (!table.build(graph_->getFlat())) {
+        return false;
+    }
+    if (!table.save(path)) {
+        LOG_ERROR("cannot write " << path);
+        return false;
+    }
+    LOG_INFO("pareto table " << path << ": " << table.getNumPoints() << " configurations");
+    return true;
+}
+
+void Parser::setDualizeDependencies(bool dualize){
+    dualizeDeps_ = dualize;
+}
+
+void Parser::setParetoTable(string path){
+    paretoTable_ = path;
+}
+
+void Parser::setSolveLimits(uint64_t nodes, double seconds){
+    nodeLimit_ = nodes;
+    timeLimit_ = seconds;
+}
+
+void Parser::setBudget(float budget){
+    budget_ = budget;
+}
+
+void Parser::writeLp(string outfile_dir) {
+    if (!graph_->isFrozen()) {
+        LOG_ERROR("no graph to write for " << appName_);
+        return;
+    }
+    string lp_path = outfile_dir + appName_ + ".lp";
+    LpWriter writer(graph_->getFlat());
+    writer.setBudget(budget_);
+    writer.setFormulation(formulation_);
+    writer.setThreads(threads_);
+    LpTemplate tpl(lp_path);
+    if (!writer.write(lp_path)) {
+        tpl.remove();
+        return;
+    }
+    LOG_INFO("wrote " << lp_path);
     
-    // end
-    out << "End";
-    out.close();
+    // remember where the budget went, for patchLp. Without --reuse-lp only
+    // a template left by an earlier run goes, it no longer matches the LP
+    if (reuseLp_ && tpl.setInput(input_)) {
+        tpl.setModel(getModel());
+        if (writer.getBudgetOffset() == LpWriter::NO_BUDGET) {
+            tpl.setBudgetField(0, 0);
+        } else {
+            tpl.setBudgetField(writer.getBudgetOffset(), LpWriter::BUDGET_WIDTH);
+        }
+        tpl.save();
+    } else {
+        tpl.remove();
+    }
+}
+
+void Parser::writeLpSweep(string outfile_dir, vector<float> budgets) {
+    if (!graph_->isFrozen()) {
+        LOG_ERROR("no graph to write for " << appName_);
+        return;
+    }
+    // <app>_<budget>.lp
+    vector<string> paths;
+    for (float budget : budgets) {
+        char num[32];
+        string_view name(num, to_chars(num, num + sizeof(num), budget).ptr - num);
+        paths.push_back(outfile_dir + appName_ + "_" + string(name) + ".lp");
+    }
+    LpWriter writer(graph_->getFlat());
+    writer.setFormulation(formulation_);
+    writer.setThreads(threads_);
+    unsigned written = writer.writeSweep(budgets, paths);
+    LOG_INFO("wrote " << written << " of " << budgets.size() << " LPs for " << appName_ << " in " << outfile_dir);
+}
+
+bool Parser::patchLp(string infile, string outfile_dir) {
+    string lp_path = outfile_dir + appName_ + ".lp";
+    LpTemplate tpl(lp_path);
+    if (!tpl.load() || !tpl.matches(infile, getModel())) {
+        LOG_DEBUG("no current LP template for " << lp_path);
+        return false;
+    }
+    if (!tpl.patchBudget(budget_)) {
+        LOG_DEBUG("could not patch the budget of " << lp_path);
+        return false;
+    }
+    LOG_INFO("patched budget " << budget_ << " into " << lp_path);
+    return true;
 }
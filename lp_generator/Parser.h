@@ -1,23 +1,78 @@
 #include "rapidxml.hpp"
 #include "KDG.h"
+#include "LpWriter.h"
+#include "Solution.h"
+#include <ostream>
 
 using namespace std;
 using namespace rapidxml;
 
+// Problems found while reading an input. They are collected here instead of
+// thrown, and only the first MAX_MESSAGES are kept verbatim.
+class ParseReport {
+private:
+    vector<string> messages_;
+    unsigned count_;
+    
+public:
+    static const unsigned MAX_MESSAGES = 100;
+    
+    ParseReport();
+    void add(string message);
+    unsigned getCount();
+    vector<string> *getMessages();
+    void print();                                 // log the summary plus the kept messages
+};
+
 class Parser{
 private:
     KDG *graph_;
     float budget_;
     string appName_;
+    ParseReport report_;
+    const char *text_; // input being parsed, error positions are offsets into it
+    vector<pair<Basic *, uint32_t> > pendingEdges_; // (sink, source name id) seen but not wired yet
+    string cacheDir_; // compiled graphs are cached here when set
+    FlatSource cacheSource_; // of the input looked up last, see loadCached
+    unsigned threads_; // worker threads, 1 keeps everything on the calling thread
+    string input_; // file the graph was built from
+    bool presolve_; // prune dominated levels before writing, see Presolve
+    bool reuseLp_; // keep an LpTemplate next to the LP for patchLp
+    bool reduceDeps_; // drop implied dependency rows on freeze, see DepGraph
+    Formulation formulation_; // of the LP written
+    uint64_t nodeLimit_; // search limits of the bnb solver, 0 for none
+    double timeLimit_;
+    bool dualizeDeps_; // price dependencies in solve("lagrange") too
+    string paretoTable_; // read by solve("pareto")
+    string getModel(); // the options the LP depends on besides the budget
     void getBasicNodeInfo(xml_node<> *xml_bnode, Basic *basic); // example impl of parsing a basic node field
-    string genKnobConstraints(); // generate the knob constraints (dependencies)
-    string genbudgetConstraint(); // generate the budget constraint
-    string genObjectiveFunction(); // generate the objective function (quality)
-    string genBinaries(); // all the LP variables should be binary
+    void setBasicField(Basic *basic, string_view field, string_view value, size_t offset);
+    bool mergeStagedKnobs(const char *text, size_t size, string infile); // parallel XML walk
+    void resolveDependencies(); // wire the pending edges once every node exists
+    bool loadCached(const char *text, size_t size, string kind, string &key); // graph from the cache
+    void storeCached(string key); // save the built graph in the cache
     
 public:
     Parser(string appName);
-    void writeLp(string output);                  // lp from XML
+    void presolve();                              // shrink the built graph if enabled, see Presolve
+    void writeLp(string output);                  // lp of the built graph, see LpWriter
+    void writeLpSweep(string output, vector<float> budgets); // one lp per budget, <app>_<budget>.lp
+    bool solve(string method, Solution &sol);    // best configuration within the budget, in process (dp, bnb, greedy, lagrange or pareto)
+    bool writePareto(string path);                // every budget's best configuration, see ParetoTable
+    bool patchLp(string input, string output);    // only update the budget of an LP written from input
     void setBudget(float budget);                // Set energy budget
     void genKDGwithXML(string input);        // generate the internal KDG with XML input
+    void genKDGwithXMLStream(string input);  // same, streaming the XML in bounded memory
+    void genKDGwithDesc(string input);       // generate the internal KDG straight from a .desc file
+    KDG *getKDG();                           // the graph built by genKDGwithXML / genKDGwithDesc
+    ParseReport *getReport();                // problems met while building the graph
+    void setCacheDir(string dir);            // reuse compiled graphs across runs, see KDGCache
+    void setSolveLimits(uint64_t nodes, double seconds); // stop solve() searching there, 0 for no limit
+    void setParetoTable(string path);        // table solve("pareto") answers from
+    void setDualizeDependencies(bool dualize); // see LagrangianSolver
+    void setFormulation(Formulation form);   // how writeLp states one level per knob, see LpWriter
+    void setPresolve(bool presolve);         // run presolve() between building and writing
+    void setReuseLp(bool reuse);             // writeLp saves what patchLp needs
+    void setReduceDependencies(bool reduce); // see DepGraph::reduce
+    void setThreads(unsigned threads);       // parse XML knobs and write the LP on this many threads
 };
@@ -0,0 +1,100 @@
+#include "Presolve.h"
+#include "Log.h"
+#include <algorithm>
+
+using namespace std;
+
+Presolve::Presolve(FlatKDG *flat):flat_(flat), numBasics_(0), numKept_(0), numEdges_(0),
+    numKeptEdges_(0) {}
+
+// sources are sorted by index and so grouped by knob: for every knob i
+// depends on, j must depend on it too, on a subset of i's sources there
+bool Presolve::coversSources(unsigned i, unsigned j) {
+    const unsigned *knob_of = flat_->getKnobOf();
+    const unsigned *dep_begin = flat_->getDepBegin();
+    const unsigned *dep_sources = flat_->getDepSources();
+    unsigned ei = dep_begin[i], ej = dep_begin[j];
+    while (ei < dep_begin[i + 1]) {
+        unsigned knob = knob_of[dep_sources[ei]];
+        unsigned end_i = ei, end_j;
+        while (end_i < dep_begin[i + 1] && knob_of[dep_sources[end_i]] == knob) {
+            end_i++;
+        }
+        while (ej < dep_begin[j + 1] && knob_of[dep_sources[ej]] < knob) {
+            ej++;
+        }
+        for (end_j = ej; end_j < dep_begin[j + 1] && knob_of[dep_sources[end_j]] == knob; end_j++);
+        if (ej == end_j || !includes(dep_sources + ei, dep_sources + end_i, dep_sources + ej, dep_sources + end_j)) {
+            return false;
+        }
+        ei = end_i;
+        ej = end_j;
+    }
+    return true;
+}
+
+bool Presolve::coversSinks(unsigned i, unsigned j) {
+    const unsigned *rev_begin = flat_->getRevDepBegin();
+    const unsigned *rev_sinks = flat_->getRevDepSinks();
+    return includes(rev_sinks + rev_begin[i], rev_sinks + rev_begin[i + 1],
+                    rev_sinks + rev_begin[j], rev_sinks + rev_begin[j + 1]);
+}
+
+bool Presolve::dominates(unsigned i, unsigned j) {
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    return cost[i] <= cost[j] && quality[i] >= quality[j] && coversSources(i, j) && coversSinks(i, j);
+}
+
+void Presolve::run() {
+    const unsigned *knob_begin = flat_->getKnobBegin();
+    const float *cost = flat_->getCosts();
+    const float *quality = flat_->getQualities();
+    numBasics_ = flat_->getNumBasics();
+    numEdges_ = flat_->getNumEdges();
+    keep_.assign(numBasics_, 1);
+    
+    // cheapest (then best) levels first: a node can only be dominated by one
+    // before it in that order, and dominance is transitive, so comparing to
+    // the kept nodes is enough. Equal nodes keep the first one.
+    vector<unsigned> order;
+    vector<unsigned> kept;
+    for (unsigned k = 0; k < flat_->getNumKnobs(); k++) {
+        order.clear();
+        kept.clear();
+        for (unsigned i = knob_begin[k]; i < knob_begin[k + 1]; i++) {
+            order.push_back(i);
+        }
+        sort(order.begin(), order.end(), [&](unsigned a, unsigned b) {
+            if (cost[a] != cost[b]) return cost[a] < cost[b];
+            if (quality[a] != quality[b]) return quality[a] > quality[b];
+            return a < b;
+        });
+        for (unsigned j : order) {
+            for (unsigned i : kept) {
+                if (dominates(i, j)) {
+                    keep_[j] = 0;
+                    LOG_DEBUG("presolve: " << flat_->getBasicName(j) << " dominated by " << flat_->getBasicName(i));
+                    break;
+                }
+            }
+            if (keep_[j]) {
+                kept.push_back(j);
+            }
+        }
+    }
+    
+    flat_->prune(keep_);
+    numKept_ = flat_->getNumBasics();
+    numKeptEdges_ = flat_->getNumEdges();
+}
+
+unsigned Presolve::getNumDropped() { return numBasics_ - numKept_; }
+
+unsigned Presolve::getNumDroppedEdges() { return numEdges_ - numKeptEdges_; }
+
+void Presolve::print() {
+    LOG_INFO("presolve: dropped " << getNumDropped() << " of " << numBasics_ << " basic nodes ("
+             << (numBasics_ > 0 ? 100 * getNumDropped() / numBasics_ : 0) << "%), "
+             << getNumDroppedEdges() << " of " << numEdges_ << " dependency edges");
+}
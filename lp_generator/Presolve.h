@@ -0,0 +1,36 @@
+#ifndef PRESOLVE_H
+#define PRESOLVE_H
+
+#include "FlatKDG.h"
+#include <vector>
+
+using namespace std;
+
+// Shrinks a compiled KDG before it is written out. Exactly one level of each
+// knob is chosen, so a level is useless when another level of the same knob
+// costs no more, gives at least as much quality and can stand in for it in
+// every dependency: its own requirements are no stronger, and every sink it
+// satisfies is satisfied by the other level too. Such dominated basic nodes
+// are dropped from the graph, which is the same as fixing them to zero.
+class Presolve {
+private:
+    FlatKDG *flat_;
+    vector<char> keep_;
+    unsigned numBasics_; // before / after
+    unsigned numKept_;
+    unsigned numEdges_;
+    unsigned numKeptEdges_;
+    
+    bool dominates(unsigned i, unsigned j);       // i can replace j in any solution
+    bool coversSources(unsigned i, unsigned j);   // whenever j's sources are met, so are i's
+    bool coversSinks(unsigned i, unsigned j);     // every sink of j is also a sink of i
+    
+public:
+    Presolve(FlatKDG *flat);
+    void run();                                   // find and drop the dominated nodes
+    unsigned getNumDropped();
+    unsigned getNumDroppedEdges();
+    void print();                                 // log how much the model shrank
+};
+
+#endif
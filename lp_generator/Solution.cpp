@@ -0,0 +1,96 @@
+#include "Solution.h"
+#include <cmath>
+
+using namespace std;
+
+Solution::Solution():cost_(0), quality_(0), bound_(INFINITY) {}
+
+void Solution::setChoice(FlatKDG *flat, const vector<unsigned> &choice) {
+    // summed in double, rounded once
+    double cost = 0, quality = 0;
+    choice_ = choice;
+    for (unsigned i : choice_) {
+        cost += flat->getCosts()[i];
+        quality += flat->getQualities()[i];
+    }
+    cost_ = cost;
+    quality_ = quality;
+}
+
+void Solution::setBound(float bound) { bound_ = bound; }
+
+vector<unsigned> *Solution::getChoice() { return &choice_; }
+
+bool Solution::isEmpty() { return choice_.empty(); }
+
+float Solution::getCost() { return cost_; }
+
+float Solution::getQuality() { return quality_; }
+
+float Solution::getBound() { return bound_; }
+
+float Solution::getGap() {
+    if (isinf(bound_)) {
+        return INFINITY;
+    }
+    float gap = bound_ - quality_;
+    return gap <= 0 ? 0 : gap / max(fabs(bound_), 1e-9f);
+}
+
+// a chosen sink needs its chosen level in each source knob to be one of
+// its sources there
+bool Solution::meetsDependencies(FlatKDG *flat, const unsigned *choice) {
+    const unsigned *knob_of = flat->getKnobOf();
+    const unsigned *dep_begin = flat->getDepBegin();
+    const unsigned *dep_sources = flat->getDepSources();
+    for (unsigned k = 0; k < flat->getNumKnobs(); k++) {
+        unsigned sink = choice[k];
+        for (unsigned e = dep_begin[sink]; e < dep_begin[sink + 1];) {
+            unsigned knob = knob_of[dep_sources[e]];
+            bool met = false;
+            for (; e < dep_begin[sink + 1] && knob_of[dep_sources[e]] == knob; e++) {
+                met |= (dep_sources[e] == choice[knob]);
+            }
+            if (!met) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool Solution::isFeasible(FlatKDG *flat, float budget) {
+    if (choice_.size() != flat->getNumKnobs()) {
+        return false;
+    }
+    for (unsigned k = 0; k < choice_.size(); k++) {
+        if (flat->getKnobOf()[choice_[k]] != k) {
+            return false;
+        }
+    }
+    return cost_ <= budget && meetsDependencies(flat, choice_.data());
+}
+
+// quality, cost and bound, then a "knob level" line per knob
+void Solution::print(ostream &out, FlatKDG *flat) {
+    if (isEmpty()) {
+        // a stopped search may not have ruled everything out
+        out << "no feasible configuration";
+        if (!isinf(bound_)) {
+            out << " found, bound " << bound_;
+        }
+        out << endl;
+        return;
+    }
+    out << "quality " << quality_ << " cost " << cost_;
+    if (getGap() == 0) {
+        out << " (optimal)";
+    } else if (!isinf(bound_)) {
+        out << " bound " << bound_ << " gap " << getGap() * 100 << "%";
+    }
+    out << "\n";
+    for (unsigned k = 0; k < choice_.size(); k++) {
+        out << flat->getKnobName(k) << " " << flat->getBasicName(choice_[k]) << "\n";
+    }
+    out.flush();
+}
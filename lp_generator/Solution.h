@@ -0,0 +1,37 @@
+#ifndef SOLUTION_H
+#define SOLUTION_H
+
+#include "FlatKDG.h"
+#include <ostream>
+#include <vector>
+
+using namespace std;
+
+// A configuration of a KDG as found by the solvers: the basic node picked
+// in every knob, with its total cost and quality. The bound is the best
+// quality any configuration could reach (as far as the solver knows), so
+// bound - quality is how far from optimal the configuration may be.
+class Solution {
+private:
+    vector<unsigned> choice_; // basic node index, per knob; empty if none was found
+    float cost_;
+    float quality_;
+    float bound_;
+    
+public:
+    Solution();
+    void setChoice(FlatKDG *flat, const vector<unsigned> &choice); // also sums up cost and quality
+    void setBound(float bound);
+    vector<unsigned> *getChoice();
+    bool isEmpty();
+    float getCost();
+    float getQuality();
+    float getBound();                             // INFINITY when unknown
+    float getGap();                               // relative, 0 when proven optimal
+    bool isFeasible(FlatKDG *flat, float budget); // within budget and every dependency met
+    void print(ostream &out, FlatKDG *flat);
+    
+    static bool meetsDependencies(FlatKDG *flat, const unsigned *choice); // choice per knob
+};
+
+#endif
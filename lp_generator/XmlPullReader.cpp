@@ -0,0 +1,176 @@
+#include "XmlPullReader.h"
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace std;
+
+static const size_t XML_CHUNK_SIZE = 1 << 20;
+
+XmlPullReader::XmlPullReader():fd_(-1), pos_(0), end_(0), base_(0), eof_(false),
+    pendingEnd_(false), offset_(0) {}
+
+bool XmlPullReader::open(string path) {
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        return false;
+    }
+    posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+    buf_.resize(XML_CHUNK_SIZE);
+    return true;
+}
+
+bool XmlPullReader::fill() {
+    if (eof_) {
+        return false;
+    }
+    // drop what has been consumed, and grow only when a single token
+    // already fills the whole buffer
+    if (pos_ > 0) {
+        memmove(buf_.data(), buf_.data() + pos_, end_ - pos_);
+        base_ += pos_;
+        end_ -= pos_;
+        pos_ = 0;
+    }
+    if (end_ == buf_.size()) {
+        buf_.resize(buf_.size() * 2);
+    }
+    ssize_t n = read(fd_, buf_.data() + end_, buf_.size() - end_);
+    if (n <= 0) {
+        eof_ = true;
+        return false;
+    }
+    end_ += n;
+    return true;
+}
+
+size_t XmlPullReader::find(const char *pattern, size_t from) {
+    size_t len = strlen(pattern);
+    for (;;) {
+        size_t i = from;
+        while (i + len <= end_) {
+            const char *hit = (const char *)memchr(&buf_[i], pattern[0], end_ - len + 1 - i);
+            if (hit == NULL) {
+                break;
+            }
+            i = hit - buf_.data();
+            if (memcmp(hit, pattern, len) == 0) {
+                return i;
+            }
+            i++;
+        }
+        // keep positions relative to pos_ across the refill
+        size_t rel = (end_ >= len ? end_ - len + 1 : 0);
+        rel = (rel > from ? rel : from) - pos_;
+        if (!fill()) {
+            return string::npos;
+        }
+        from = pos_ + rel;
+    }
+}
+
+XmlPullReader::Event XmlPullReader::fail(string message) {
+    error_ = "offset " + to_string(base_ + pos_) + ": " + message;
+    return ERROR;
+}
+
+XmlPullReader::Event XmlPullReader::next() {
+    if (pendingEnd_) {
+        pendingEnd_ = false;
+        return END;
+    }
+    
+    for (;;) {
+        if (pos_ == end_ && !fill()) {
+            return DONE;
+        }
+        offset_ = base_ + pos_;
+        
+        if (buf_[pos_] != '<') {
+            // character data up to the next tag
+            size_t lt = find("<", pos_);
+            size_t stop = (lt == string::npos ? end_ : lt);
+            size_t b = pos_, e = stop;
+            while (b < e && isspace((unsigned char)buf_[b])) b++;
+            while (e > b && isspace((unsigned char)buf_[e - 1])) e--;
+            offset_ = base_ + b;
+            text_ = string_view(buf_.data() + b, e - b);
+            pos_ = stop;
+            if (b < e) {
+                return TEXT;
+            }
+            continue;
+        }
+        
+        // make sure the few bytes telling the tag kinds apart are in
+        while (end_ - pos_ < 4 && fill()) {}
+        const char *p = buf_.data() + pos_;
+        size_t avail = end_ - pos_;
+        
+        if (avail >= 4 && memcmp(p, "<!--", 4) == 0) {
+            size_t close = find("-->", pos_ + 4);
+            if (close == string::npos) {
+                return fail("unterminated comment");
+            }
+            pos_ = close + 3;
+            continue;
+        }
+        if (avail >= 2 && (p[1] == '?' || p[1] == '!')) {
+            // declaration, processing instruction or doctype
+            size_t close = find(">", pos_ + 2);
+            if (close == string::npos) {
+                return fail("unterminated declaration");
+            }
+            pos_ = close + 1;
+            continue;
+        }
+        
+        size_t close = find(">", pos_ + 1);
+        if (close == string::npos) {
+            return fail("unterminated tag");
+        }
+        p = buf_.data() + pos_;
+        const char *tag_end = buf_.data() + close;
+        bool closing = (p[1] == '/');
+        bool self_closing = (!closing && tag_end[-1] == '/');
+        const char *n = p + (closing ? 2 : 1);
+        const char *n_end = n;
+        while (n_end < tag_end && !isspace((unsigned char)*n_end) && *n_end != '/') n_end++;
+        if (n_end == n) {
+            return fail("tag without a name");
+        }
+        name_ = string_view(n, n_end - n);
+        if (closing) {
+            if (openBegin_.empty()) {
+                return fail("</" + string(name_) + "> closes no element");
+            }
+            string_view open = string_view(openNames_).substr(openBegin_.back());
+            if (open != name_) {
+                return fail("</" + string(name_) + "> closes <" + string(open) + ">");
+            }
+            openNames_.resize(openBegin_.back());
+            openBegin_.pop_back();
+        } else if (!self_closing) {
+            openBegin_.push_back(openNames_.size());
+            openNames_.append(name_);
+        }
+        pos_ = close + 1;
+        pendingEnd_ = self_closing;
+        return closing ? END : START;
+    }
+}
+
+string_view XmlPullReader::getName() { return name_; }
+
+string_view XmlPullReader::getText() { return text_; }
+
+size_t XmlPullReader::getOffset() { return offset_; }
+
+string XmlPullReader::getError() { return error_; }
+
+XmlPullReader::~XmlPullReader() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
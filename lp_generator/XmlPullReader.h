@@ -0,0 +1,52 @@
+#ifndef XMLPULLREADER_H
+#define XMLPULLREADER_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+// Pull parser for the element-only XML exchanged by the KDG tools.
+// The input is read in fixed size chunks, so memory use is bounded by the
+// longest single token instead of the file size. Attributes, comments,
+// declarations and processing instructions are skipped, entities are not
+// translated (the same as the in-memory parse_fastest mode).
+// Names and text are views into the reader's buffer, only valid until the
+// next call to next(). An end tag must name the element it closes.
+class XmlPullReader {
+public:
+    enum Event { START, END, TEXT, DONE, ERROR };
+    
+private:
+    int fd_;
+    vector<char> buf_;
+    size_t pos_;       // next unread byte in buf_
+    size_t end_;       // end of valid data in buf_
+    size_t base_;      // input offset of buf_[0]
+    bool eof_;
+    bool pendingEnd_;  // a self closing element still owes its END
+    string_view name_;
+    string_view text_;
+    string openNames_;        // names of the open elements, outermost first
+    vector<size_t> openBegin_; // where each starts in openNames_
+    size_t offset_;
+    string error_;
+    
+    bool fill();                                  // read more input, false at end of file
+    size_t find(const char *pattern, size_t from); // position of pattern at/after from, npos at EOF
+    Event fail(string message);
+    
+public:
+    XmlPullReader();
+    bool open(string path);
+    Event next();
+    string_view getName();                        // element name of a START / END
+    string_view getText();                        // whitespace trimmed text of a TEXT
+    size_t getOffset();                           // input offset of the current event
+    string getError();
+    ~XmlPullReader();
+};
+
+#endif
@@ -1,5 +1,8 @@
+#include <cstring>
 #include <iostream>
 #include <string>
+#include <vector>
+#include "Log.h"
 #include "Parser.h"
 
 using namespace std;
@@ -7,8 +10,55 @@ using namespace std;
 
 float budget = 0.;
 string inputXML = "";
+string inputDesc = "";
 string outputLPDir = "../example_output/";
 string appName = "";
+string cacheDir = "";
+bool streamXML = false;
+unsigned threads = 1;
+bool reuseLp = false;
+bool reduceDeps = false;
+bool presolve = false;
+Formulation formulation = FORM_ONEHOT;
+vector<float> budgets;
+string solver = "";
+uint64_t nodeLimit = 0;
+double timeLimit = 10;
+string paretoTable = "";
+bool dualizeDeps = false;
+
+// "a:b:step" for a grid from a to b, or "a,b,c"; false if malformed
+static bool parseBudgets(string spec, vector<float> &out) {
+    try {
+        size_t colon = spec.find(':');
+        if (colon != string::npos) {
+            size_t colon2 = spec.find(':', colon + 1);
+            if (colon2 == string::npos)
+                return false;
+            float first = stof(spec.substr(0, colon));
+            float last = stof(spec.substr(colon + 1, colon2 - colon - 1));
+            float step = stof(spec.substr(colon2 + 1));
+            if (step <= 0 || last < first)
+                return false;
+            // multiply rather than accumulate, so the grid does not drift
+            unsigned count = (unsigned)((last - first) / step + 1e-4) + 1;
+            for (unsigned i = 0; i < count; i++)
+                out.push_back(first + i * step);
+        } else {
+            size_t begin = 0;
+            while (begin <= spec.size()) {
+                size_t comma = spec.find(',', begin);
+                if (comma == string::npos)
+                    comma = spec.size();
+                out.push_back(stof(spec.substr(begin, comma - begin)));
+                begin = comma + 1;
+            }
+        }
+    } catch (exception &) {
+        return false;
+    }
+    return !out.empty();
+}
 
 int main(int argc, const char **argv){
 
@@ -16,22 +66,107 @@ int main(int argc, const char **argv){
         for (int i = 1; i < argc; i++) {
             if (!strcmp(argv[i], "--xml"))
                 inputXML = argv[++i];
+            if (!strcmp(argv[i], "--desc"))
+                inputDesc = argv[++i];
             if (!strcmp(argv[i], "--outdir")){
                 outputLPDir = argv[++i];
             }
             if (!strcmp(argv[i], "--budget"))
                 budget = stof(argv[++i]);
+            if (!strcmp(argv[i], "--budgets") && !parseBudgets(argv[++i], budgets)) {
+                cout << "bad budget list " << argv[i] << ", use <from>:<to>:<step> or <b1>,<b2>,..." << endl;
+                exit(1);
+            }
+            if (!strcmp(argv[i], "--solve"))
+                solver = argv[++i];
+            if (!strcmp(argv[i], "--node-limit"))
+                nodeLimit = stoull(argv[++i]);
+            if (!strcmp(argv[i], "--time-limit"))
+                timeLimit = stod(argv[++i]);
+            if (!strcmp(argv[i], "--pareto"))
+                paretoTable = argv[++i];
+            if (!strcmp(argv[i], "--dualize-deps"))
+                dualizeDeps = true;
             if (!strcmp(argv[i], "--app"))
                 appName = argv[++i];
+            if (!strcmp(argv[i], "--cache-dir"))
+                cacheDir = argv[++i];
+            if (!strcmp(argv[i], "--stream"))
+                streamXML = true;
+            if (!strcmp(argv[i], "--presolve"))
+                presolve = true;
+            if (!strcmp(argv[i], "--reuse-lp"))
+                reuseLp = true;
+            if (!strcmp(argv[i], "--reduce-deps"))
+                reduceDeps = true;
+            if (!strcmp(argv[i], "--threads"))
+                threads = stoi(argv[++i]);
+            if (!strcmp(argv[i], "--formulation") && !LpWriter::parseFormulation(argv[++i], formulation)) {
+                cout << "unknown formulation " << argv[i] << ", use binary, onehot or sos" << endl;
+                exit(1);
+            }
+            if (!strcmp(argv[i], "--log-level") && !Log::setLevel(argv[++i])) {
+                cout << "unknown log level " << argv[i] << ", use quiet, info, debug or trace" << endl;
+                exit(1);
+            }
         }
     } else{
-        cout << "argument missing: needs at least --app <application_name> --xml <xml_file_path> --budget <budget>";
+        cout << "argument missing: needs at least --app <application_name> --xml <xml_file_path> (or --desc <desc_file_path>) --budget <budget> (or --budgets <from>:<to>:<step> | <b1>,<b2>,...)"
+             << " [--outdir <dir>] [--cache-dir <dir>] [--stream] [--threads <n>] [--reuse-lp] [--reduce-deps] [--presolve] [--formulation binary|onehot|sos] [--solve dp|bnb|greedy|lagrange|pareto] [--node-limit <n>] [--time-limit <seconds>] [--dualize-deps] [--pareto <table_file>] [--log-level quiet|info|debug|trace]" << endl;
+        exit(1);
+    }
+    // dominance relies on exactly one level of each knob being chosen
+    if (presolve && formulation == FORM_BINARY) {
+        cout << "--presolve needs one level per knob, use it with --formulation onehot or sos" << endl;
         exit(1);
     }
 
     Parser* parser = new Parser(appName);
-    parser->genKDGwithXML(inputXML);
+    parser->setCacheDir(cacheDir);
+    parser->setThreads(threads);
+    parser->setPresolve(presolve);
+    parser->setReuseLp(reuseLp);
+    parser->setReduceDependencies(reduceDeps);
+    parser->setFormulation(formulation);
+    parser->setSolveLimits(nodeLimit, timeLimit);
+    parser->setParetoTable(paretoTable);
+    parser->setDualizeDependencies(dualizeDeps);
     parser->setBudget(budget);
-    parser->writeLp(outputLPDir);
+
+    // with only the budget changed since the last run, patch the LP in place
+    string input = inputDesc.empty() ? inputXML : inputDesc;
+    if (reuseLp && budgets.empty() && solver.empty() && paretoTable.empty() && parser->patchLp(input, outputLPDir)) {
+        Log::flush();
+        return 0;
+    }
+
+    if (!inputDesc.empty())
+        parser->genKDGwithDesc(inputDesc);
+    else if (streamXML)
+        parser->genKDGwithXMLStream(inputXML);
+    else
+        parser->genKDGwithXML(inputXML);
+    if (parser->getReport()->getCount() > 0)
+        parser->getReport()->print();
+    parser->presolve();
+    if (!solver.empty()) {
+        // answer directly instead of writing the LP
+        Solution sol;
+        if (!parser->solve(solver, sol)) {
+            Log::flush();
+            exit(1);
+        }
+        sol.print(cout, parser->getKDG()->getFlat());
+    } else if (!paretoTable.empty()) {
+        // offline: every budget at once, for --solve pareto to look up
+        if (!parser->writePareto(paretoTable)) {
+            Log::flush();
+            exit(1);
+        }
+    } else if (!budgets.empty())
+        parser->writeLpSweep(outputLPDir, budgets);
+    else
+        parser->writeLp(outputLPDir);
+    Log::flush();
 
 }
@@ -0,0 +1,84 @@
+#!/bin/bash
+# Regression checks for lp_generator, run by `make test` in lp_generator/.
+# Each test_*.sh here checks one feature, with the helpers below.
+# usage: run_tests.sh <lp_generator binary>
+
+BIN=$(realpath "${1:-../lp_generator/lp_generator}")
+HERE=$(dirname "$(realpath "$0")")
+ROOT=$(dirname "$HERE")
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+FAILED=0
+
+SMALL="--xml $ROOT/example_output/Small.xml"
+SMALL_BUDGETS=$(seq 0 5 120)
+MEDIUM="--desc $HERE/Medium.desc"
+MEDIUM_BUDGETS=$(seq 0 5 200)
+
+fail() {
+    echo "FAIL: $*"
+    FAILED=$((FAILED + 1))
+}
+
+# first line of a --solve run: "quality <q> cost <c> ..." or "no feasible configuration"
+solve() {
+    "$BIN" "$@" --outdir "$WORK/" | head -1
+}
+
+# LP output: every input path gives the reference LP
+lp_output() {
+    local name=$1
+    shift
+    mkdir -p "$WORK/$name"
+    "$BIN" --app Small "$@" --budget 99 --outdir "$WORK/$name/"
+    if [ ! -f "$WORK/$name/Small.lp" ]; then
+        fail "$name: no LP written"
+    elif ! cmp -s "$WORK/$name/Small.lp" "$ROOT/example_output/Small.lp"; then
+        fail "$name: LP differs from example_output/Small.lp"
+    fi
+}
+
+# quality of the answer, nothing if no configuration fits
+quality() {
+    awk '/^quality/ {print $2}'
+}
+
+# checks "$@" against --solve dp on every budget: an exact solver finds the
+# same quality, a heuristic stays within the budget, does not beat dp and
+# finds something whenever dp does
+against_dp() {
+    local kind=$1 app=$2 input=$3 budgets=$4
+    shift 4
+    local b dp dp_q out
+    for b in $budgets; do
+        dp=$(solve --app $app $input --budget $b --solve dp)
+        dp_q=$(echo "$dp" | quality)
+        out=$(solve --app $app $input --budget $b "$@")
+        if [ $kind = exact ] || [ -z "$dp_q" ]; then
+            [ "$(echo "$out" | quality)" = "$dp_q" ] || fail "$app budget $b: $* gives '$out', dp '$dp'"
+        else
+            echo "$out" | awk -v b=$b -v q=$dp_q '/^quality/ && $2 <= q && $4 <= b {ok = 1} END {exit !ok}' \
+                || fail "$app budget $b: $* gives '$out', dp '$dp'"
+        fi
+    done
+}
+
+# bad input: the run reports it and writes no LP
+rejects() {
+    local what=$1 xml=$2
+    shift 2
+    mkdir -p "$WORK/bad"
+    rm -f "$WORK/bad/Bad.lp"
+    "$BIN" --app Bad --xml "$xml" --budget 99 "$@" --outdir "$WORK/bad/" >/dev/null 2>&1
+    [ -f "$WORK/bad/Bad.lp" ] && fail "$what"
+}
+
+for test in "$HERE"/test_*.sh; do
+    source "$test"
+done
+
+if [ $FAILED -ne 0 ]; then
+    echo "$FAILED check(s) failed"
+    exit 1
+fi
+echo "all checks passed"
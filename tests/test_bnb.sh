@@ -0,0 +1,12 @@
+# branch-and-bound with LP relaxation bounds (user-022)
+
+against_dp exact Small "$SMALL" "$SMALL_BUDGETS" --solve bnb
+against_dp exact Medium "$MEDIUM" "$MEDIUM_BUDGETS" --solve bnb
+
+# real valued costs, on which running float sums went over the budget on
+# the first and short of the optimum on the second
+for answer in 253:2.95:6.1 279:0.85:3.75; do
+    IFS=: read graph b best <<< "$answer"
+    q=$(solve --app Real$graph --desc "$HERE/Real$graph.desc" --budget $b --solve bnb | quality)
+    [ "$q" = "$best" ] || fail "bnb: Real$graph budget $b gives quality '$q', not '$best'"
+done
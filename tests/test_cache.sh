@@ -0,0 +1,24 @@
+# compiled graph cache (user-011)
+
+mkdir -p "$WORK/cache/dir" "$WORK/cache/edit"
+cp "$ROOT/example_output/Small.xml" "$WORK/cache/Small.xml"
+for run in store load; do
+    "$BIN" --app Small --xml "$WORK/cache/Small.xml" --cache-dir "$WORK/cache/dir" --budget 99 --outdir "$WORK/cache/"
+    cmp -s "$WORK/cache/Small.lp" "$ROOT/example_output/Small.lp" || fail "cache: $run run writes another LP"
+done
+[ "$(ls "$WORK/cache/dir" | wc -l)" = 1 ] || fail "cache: no graph stored"
+
+# two digits at offsets 7 mod 8 apart used to give the same key
+printf '80' | dd of="$WORK/cache/Small.xml" bs=1 seek=855 conv=notrunc 2>/dev/null
+printf '60' | dd of="$WORK/cache/Small.xml" bs=1 seek=1663 conv=notrunc 2>/dev/null
+cp "$WORK/cache/Small.xml" "$WORK/cache/edit/Small.xml"
+"$BIN" --app Small --xml "$WORK/cache/edit/Small.xml" --budget 99 --outdir "$WORK/cache/edit/"
+"$BIN" --app Small --xml "$WORK/cache/Small.xml" --cache-dir "$WORK/cache/dir" --budget 99 --outdir "$WORK/cache/"
+cmp -s "$WORK/cache/Small.lp" "$WORK/cache/edit/Small.lp" || fail "cache: edited input answered from the cache"
+
+# a damaged graph is a miss, not a crash
+for file in "$WORK"/cache/dir/*.kdg; do
+    head -c 256 /dev/urandom | dd of="$file" bs=1 seek=72 conv=notrunc 2>/dev/null
+done
+"$BIN" --app Small --xml "$WORK/cache/Small.xml" --cache-dir "$WORK/cache/dir" --budget 99 --outdir "$WORK/cache/"
+cmp -s "$WORK/cache/Small.lp" "$WORK/cache/edit/Small.lp" || fail "cache: damaged graph was used"
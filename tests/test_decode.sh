@@ -0,0 +1,27 @@
+# number decoding of costs and qualities (user-008)
+
+mkdir -p "$WORK/decode"
+# every way of reading the XML reports the same values
+for path in dom stream threads; do
+    case $path in
+        dom) opts= ;;
+        stream) opts=--stream ;;
+        threads) opts="--threads 3" ;;
+    esac
+    for v in nan inf -inf +inf infinity +-5 ++5 -+5 1e99 5x; do
+        sed "0,/<cost>10<\/cost>/s//<cost>$v<\/cost>/" "$ROOT/example_output/Small.xml" > "$WORK/decode/Bad.xml"
+        "$BIN" --app Bad --xml "$WORK/decode/Bad.xml" --budget 99 $opts --log-level info --outdir "$WORK/decode/" 2>&1 \
+            | grep -qF "bad cost '$v'" || fail "decode: $path accepts cost '$v'"
+    done
+    for v in 10 +10 ' 10 ' 1e1 10.0; do
+        sed "0,/<cost>10<\/cost>/s//<cost>$v<\/cost>/" "$ROOT/example_output/Small.xml" > "$WORK/decode/Good.xml"
+        "$BIN" --app Small --xml "$WORK/decode/Good.xml" --budget 99 $opts --outdir "$WORK/decode/" 2>&1 \
+            | grep -q "problem" && fail "decode: $path rejects cost '$v'"
+        cmp -s "$WORK/decode/Small.lp" "$ROOT/example_output/Small.lp" || fail "decode: $path reads cost '$v' as another value"
+    done
+done
+
+# nor does the description take a value that is no number
+printf 'Nan\n\n<Knobs>\nA [(nan-1),(2-2)]\n' > "$WORK/decode/Nan.desc"
+"$BIN" --app Nan --desc "$WORK/decode/Nan.desc" --budget 99 --outdir "$WORK/decode/" 2>&1 \
+    | grep -q "problem" || fail "decode: desc accepts cost 'nan'"
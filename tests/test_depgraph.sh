@@ -0,0 +1,37 @@
+# dependency order, cycles and implied rows (user-018)
+
+D="$WORK/depgraph"
+mkdir -p "$D/cache"
+printf 'Chain\n\n<Knobs>\nA [(1-1),(2-2)]\nB [(1-1),(2-2)]\nC [(1-1),(2-2)]\n' > "$D/Chain.desc"
+printf '\n<Dependencies>\nA.0 <- [B.0]\nB.0 <- [C.0]\nA.0 <- [C.0]\n' >> "$D/Chain.desc"
+
+# rows of the LP that tie A_0 to C_0
+chain_rows() {
+    "$BIN" --app Chain --desc "$D/Chain.desc" --budget 5 "$@" --outdir "$D/" >/dev/null
+    grep -c '^ dep_A_0_C:' "$D/Chain.lp"
+}
+
+# A.0 <- [C.0] follows from the other two, but is only dropped on request
+[ "$(chain_rows)" = 1 ] || fail "depgraph: implied row dropped without --reduce-deps"
+[ "$(chain_rows --reduce-deps)" = 0 ] || fail "depgraph: implied row kept with --reduce-deps"
+# a graph cached unreduced is not taken for the reduced one, nor the other way
+[ "$(chain_rows --cache-dir "$D/cache")" = 1 ] || fail "depgraph: implied row dropped on store"
+[ "$(chain_rows --cache-dir "$D/cache" --reduce-deps)" = 0 ] || fail "depgraph: unreduced graph taken from the cache"
+[ "$(chain_rows --cache-dir "$D/cache")" = 1 ] || fail "depgraph: reduced graph taken from the cache"
+
+# dropping implied rows never changes the optimum
+against_dp exact Medium "$MEDIUM" "$MEDIUM_BUDGETS" --solve dp --reduce-deps
+"$BIN" --app Medium $MEDIUM --budget 80 --reduce-deps --log-level info --outdir "$D/" 2>&1 \
+    | grep -q '(5 implied ones dropped)' || fail "depgraph: Medium rows not reduced"
+
+# every node of a cycle is named, and a cycle is no reason to stop
+printf 'Loop\n\n<Knobs>\nA [(1-1),(2-2)]\nB [(1-1),(2-2)]\nC [(1-1),(2-2)]\n' > "$D/Loop.desc"
+printf '\n<Dependencies>\nA.1 <- [B.1]\nB.1 <- [C.1]\nC.1 <- [A.1]\nC.0 <- [C.1,B.0]\n' >> "$D/Loop.desc"
+log=$("$BIN" --app Loop --desc "$D/Loop.desc" --budget 99 --reduce-deps --outdir "$D/" 2>&1 >/dev/null)
+for node in A_1 B_1 C_1; do
+    echo "$log" | grep -q "^KDG Loop: dependency cycle through.* $node" || fail "depgraph: $node not reported on the cycle"
+done
+echo "$log" | grep -q "C_0" && fail "depgraph: C_0 reported on the cycle"
+[ -f "$D/Loop.lp" ] || fail "depgraph: no LP for a graph with a cycle"
+q=$(solve --app Loop --desc "$D/Loop.desc" --budget 99 --solve dp --reduce-deps 2>/dev/null | quality)
+[ "$q" = 6 ] || fail "depgraph: Loop gives quality '$q', not 6"
@@ -0,0 +1,8 @@
+# .desc input without the XML step (user-002)
+
+# the description lists the knobs in another order, so only the lines have to match
+mkdir -p "$WORK/desc"
+"$BIN" --app Small --desc "$ROOT/example_input/Small.desc" --budget 99 --outdir "$WORK/desc/"
+if ! diff -q <(sort "$WORK/desc/Small.lp" 2>/dev/null) <(sort "$ROOT/example_output/Small.lp") >/dev/null; then
+    fail "desc: LP differs from example_output/Small.lp"
+fi
@@ -0,0 +1,43 @@
+# exact multiple-choice knapsack solver (user-021)
+
+# the optimum of Small, by hand
+for answer in 0: 20:20 35:30 45:40 60:60 99:60 200:60; do
+    b=${answer%:*}
+    q=$(solve --app Small $SMALL --budget $b --solve dp | quality)
+    [ "$q" = "${answer#*:}" ] || fail "dp: Small budget $b gives quality '$q', not '${answer#*:}'"
+done
+
+# every answer fits its budget
+for b in $MEDIUM_BUDGETS; do
+    solve --app Medium $MEDIUM --budget $b --solve dp | awk -v b=$b '!/^quality/ || $4 <= b {ok = 1} END {exit !ok}' \
+        || fail "dp: Medium budget $b goes over the budget"
+done
+
+# 10000000 + 0.5 is 10000000 in float: a cheapest cost summed in float left
+# room the budget does not have
+mkdir -p "$WORK/dp"
+printf 'Base\n\n<Knobs>\nK0 [(10000000-1)]\n' > "$WORK/dp/Base.desc"
+for k in 1 2 3 4; do
+    echo "K$k [(0.5-1),(1.5-5)]" >> "$WORK/dp/Base.desc"
+done
+q=$(solve --app Base --desc "$WORK/dp/Base.desc" --budget 10000002 --solve dp | quality)
+[ "$q" = 5 ] || fail "dp: Base budget 10000002 gives quality '$q', not 5"
+
+# one group of 24 knobs whose last rows rule out every choice: the search
+# has to give up, not walk 4^24 partial choices
+{
+    printf 'Wide\n\n<Knobs>\n'
+    for k in $(seq 0 23); do
+        echo "K$k [(1-1),(2-2),(3-3),(4-4)]"
+    done
+    printf '\n<Dependencies>\n'
+    for k in $(seq 1 23); do
+        echo "K$k.0 <- [K$((k - 1)).0,K$((k - 1)).1,K$((k - 1)).2,K$((k - 1)).3]"
+    done
+    for l in 0 1 2 3; do
+        echo "K22.$l <- [K0.1]"
+        echo "K23.$l <- [K0.0]"
+    done
+} > "$WORK/dp/Wide.desc"
+timeout 20 "$BIN" --app Wide --desc "$WORK/dp/Wide.desc" --budget 100 --solve dp --outdir "$WORK/dp/" >/dev/null 2>&1
+[ $? = 124 ] && fail "dp: Wide group search does not stop"
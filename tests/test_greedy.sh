@@ -0,0 +1,7 @@
+# convex hull greedy heuristic (user-023)
+
+against_dp heuristic Small "$SMALL" "$SMALL_BUDGETS" --solve greedy
+against_dp heuristic Medium "$MEDIUM" "$MEDIUM_BUDGETS" --solve greedy
+
+# the levels of Small are collinear; dropping them from the hull stopped short
+against_dp exact Small "$SMALL" "35 60 99" --solve greedy
@@ -0,0 +1,36 @@
+# XML knobs parsed on several threads (user-013)
+
+# the threaded path takes exactly what the single threaded one takes
+same_as_dom() {
+    local what=$1 xml=$2
+    rm -rf "$WORK/stager/dom" "$WORK/stager/threads"
+    mkdir -p "$WORK/stager/dom" "$WORK/stager/threads"
+    "$BIN" --app Variant --xml "$xml" --budget 99 --outdir "$WORK/stager/dom/" >/dev/null 2>&1
+    "$BIN" --app Variant --xml "$xml" --budget 99 --threads 3 --outdir "$WORK/stager/threads/" >/dev/null 2>&1
+    if [ -f "$WORK/stager/dom/Variant.lp" ] || [ -f "$WORK/stager/threads/Variant.lp" ]; then
+        cmp -s "$WORK/stager/dom/Variant.lp" "$WORK/stager/threads/Variant.lp" || fail "knobstager: $what differs from the DOM path"
+    fi
+}
+
+XML="$ROOT/example_output/Small.xml"
+SIZE=$(stat -c %s "$XML")
+mkdir -p "$WORK/stager"
+for cut in 100 600 $((SIZE / 2)) $((SIZE - 12)) $((SIZE - 2)); do
+    head -c $cut "$XML" > "$WORK/stager/cut.xml"
+    same_as_dom "XML cut at byte $cut" "$WORK/stager/cut.xml"
+done
+
+variant() {
+    local what=$1
+    shift
+    "$@" > "$WORK/stager/variant.xml"
+    same_as_dom "$what" "$WORK/stager/variant.xml"
+}
+EXTRA='<knob><knobname>X</knobname><knoblayer><basicnode><nodename>X_0</nodename><cost>1</cost><quality>1</quality></basicnode></knoblayer></knob>'
+variant "knob in a comment" sed "s#<resource>#<resource><!-- $EXTRA -->#" "$XML"
+variant "knob after the root" bash -c "cat '$XML'; echo '$EXTRA'"
+variant "knob below another element" sed "s#<resource>#<resource><group>$EXTRA</group>#" "$XML"
+variant "'>' in an attribute" sed 's#<resource>#<resource note="a > b">#' "$XML"
+variant "text after the root" bash -c "cat '$XML'; echo junk"
+variant "stray closing tag" bash -c "cat '$XML'; echo '</knob>'"
+variant "mismatched closing tag" sed '0,/<\/knobname>/s//<\/knobnam>/' "$XML"
@@ -0,0 +1,6 @@
+# Lagrangian relaxation (user-025)
+
+against_dp heuristic Small "$SMALL" "$SMALL_BUDGETS" --solve lagrange
+against_dp heuristic Medium "$MEDIUM" "$MEDIUM_BUDGETS" --solve lagrange --threads 3
+against_dp heuristic Medium "$MEDIUM" "60 80 120" --solve lagrange --dualize-deps
+against_dp exact Small "$SMALL" "35 60 99" --solve lagrange
@@ -0,0 +1,11 @@
+# LP text from the buffered writer (user-014)
+
+# the budget is right-aligned, the line ends at the number
+grep -q '^ <= *99$' "$ROOT/example_output/Small.lp" || fail "lpwriter: budget line does not end at the budget"
+
+# no level costs anything: no budget row, it would have no terms
+mkdir -p "$WORK/free"
+sed 's#<cost>[^<]*</cost>#<cost>0</cost>#' "$ROOT/example_output/Small.xml" > "$WORK/free/Free.xml"
+"$BIN" --app Free --xml "$WORK/free/Free.xml" --budget 99 --outdir "$WORK/free/"
+grep -q "budget" "$WORK/free/Free.lp" && fail "lpwriter: LP without costs has a budget row"
+rejects "lpwriter: negative budget accepted without costs" "$WORK/free/Free.xml" --budget -1
@@ -0,0 +1,10 @@
+# precomputed Pareto table (user-024)
+
+"$BIN" --app Small $SMALL --pareto "$WORK/Small.pt" --outdir "$WORK/"
+"$BIN" --app Medium $MEDIUM --pareto "$WORK/Medium.pt" --outdir "$WORK/"
+against_dp exact Small "$SMALL" "$SMALL_BUDGETS" --solve pareto --pareto "$WORK/Small.pt"
+against_dp exact Medium "$MEDIUM" "$MEDIUM_BUDGETS" --solve pareto --pareto "$WORK/Medium.pt"
+
+# a table of another graph is refused
+out=$(solve --app Medium $MEDIUM --budget 80 --solve pareto --pareto "$WORK/Small.pt" 2>&1)
+echo "$out" | grep -q '^quality' && fail "pareto: answered Medium from the table of Small"
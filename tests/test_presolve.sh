@@ -0,0 +1,22 @@
+# dominated levels dropped before solving (user-017)
+
+# dropping a level another one beats never changes the optimum
+against_dp exact Small "$SMALL" "$SMALL_BUDGETS" --solve dp --presolve
+against_dp exact Medium "$MEDIUM" "$MEDIUM_BUDGETS" --solve dp --presolve
+
+# a dominated level on a dependency cycle
+mkdir -p "$WORK/presolve"
+printf 'Loop\n\n<Knobs>\nA [(1-1),(2-1)]\nB [(1-1),(3-4)]\nC [(0-0),(5-5)]\n' > "$WORK/presolve/Loop.desc"
+printf '\n<Dependencies>\nA.0 <- [B.0]\nA.1 <- [B.0]\nB.0 <- [A.0,A.1]\nC.1 <- [B.1]\n' >> "$WORK/presolve/Loop.desc"
+against_dp exact Loop "--desc $WORK/presolve/Loop.desc" "0 2 5 12" --solve dp --presolve 2>/dev/null
+
+# without a row per knob any set of levels may be chosen
+rm -f "$WORK/presolve/Small.lp"
+"$BIN" --app Small $SMALL --budget 99 --presolve --formulation binary --outdir "$WORK/presolve/" >/dev/null 2>&1
+[ -f "$WORK/presolve/Small.lp" ] && fail "presolve: ran with --formulation binary"
+
+# the report follows --log-level
+log=$("$BIN" --app Medium $MEDIUM --budget 80 --presolve --outdir "$WORK/presolve/" 2>&1 >/dev/null)
+[ -z "$log" ] || fail "presolve: quiet run logs '$log'"
+"$BIN" --app Medium $MEDIUM --budget 80 --presolve --log-level info --outdir "$WORK/presolve/" 2>&1 \
+    | grep -q '^presolve: dropped 13 of 32' || fail "presolve: no report at --log-level info"
@@ -0,0 +1,49 @@
+# patching the budget of an existing LP (user-016)
+
+R="$WORK/reuse"
+mkdir -p "$R/fresh"
+cp "$ROOT/example_output/Small.xml" "$R/Small.xml"
+cp "$ROOT/example_output/Small.xml" "$R/fresh/Small.xml"
+
+# what a --reuse-lp run does: "patched" or "wrote"
+reuse() {
+    "$BIN" --app Small --xml "$R/Small.xml" --reuse-lp --log-level info "$@" --outdir "$R/" 2>&1 \
+        | awk '/^patched budget/ {print "patched"} /^wrote/ {print "wrote"}'
+}
+
+# the LP a plain run writes for the reused input
+fresh() {
+    "$BIN" --app Small --xml "$R/fresh/Small.xml" "$@" --outdir "$R/fresh/"
+    [ -f "$R/fresh/Small.lp.tpl" ] && fail "reuse: template written without --reuse-lp"
+    cmp -s "$R/Small.lp" "$R/fresh/Small.lp" || fail "reuse: LP differs from a fresh one after $*"
+}
+
+[ "$(reuse --budget 99)" = wrote ] || fail "reuse: first run did not write the LP"
+fresh --budget 99
+[ "$(reuse --budget 45)" = patched ] || fail "reuse: budget change not patched"
+fresh --budget 45
+[ "$(reuse --budget 45 --formulation sos)" = wrote ] || fail "reuse: LP of another formulation patched"
+fresh --budget 45 --formulation sos
+[ "$(reuse --budget 45)" = wrote ] || fail "reuse: LP of another formulation patched"
+
+# the input changed since
+sed -i 's#<cost>10</cost>#<cost>11</cost>#' "$R/Small.xml" "$R/fresh/Small.xml"
+[ "$(reuse --budget 60)" = wrote ] || fail "reuse: LP of a changed input patched"
+fresh --budget 60
+
+# the LP was rewritten since, even to the same bytes
+cp "$R/Small.lp" "$R/copy.lp"
+cp "$R/copy.lp" "$R/Small.lp"
+[ "$(reuse --budget 70)" = wrote ] || fail "reuse: rewritten LP patched"
+fresh --budget 70
+
+# no level costs anything: nothing to patch, any budget it can meet holds
+sed -i 's#<cost>[^<]*</cost>#<cost>0</cost>#' "$R/Small.xml" "$R/fresh/Small.xml"
+[ "$(reuse --budget 10)" = wrote ] || fail "reuse: LP of a changed input patched"
+[ "$(reuse --budget 20)" = patched ] || fail "reuse: LP without a budget row not reused"
+fresh --budget 20
+
+# a plain run leaves no stale template behind
+"$BIN" --app Small --xml "$R/Small.xml" --budget 30 --outdir "$R/"
+[ -f "$R/Small.lp.tpl" ] && fail "reuse: plain run kept the template"
+[ "$(reuse --budget 40)" = wrote ] || fail "reuse: patched without a template"
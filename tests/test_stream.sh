@@ -0,0 +1,13 @@
+# streaming XML ingestion (user-012)
+
+lp_output stream --xml "$ROOT/example_output/Small.xml" --stream
+
+# truncated or mismatched XML
+mkdir -p "$WORK/cut"
+SIZE=$(stat -c %s "$ROOT/example_output/Small.xml")
+for cut in 100 $((SIZE / 2)) $((SIZE - 12)) $((SIZE - 2)); do
+    head -c $cut "$ROOT/example_output/Small.xml" > "$WORK/cut/Cut$cut.xml"
+    rejects "stream: accepted XML cut at byte $cut" "$WORK/cut/Cut$cut.xml" --stream
+done
+sed '0,/<\/knoblayer>/s//<\/knob>/' "$ROOT/example_output/Small.xml" > "$WORK/cut/Mismatched.xml"
+rejects "stream: accepted mismatched end tags" "$WORK/cut/Mismatched.xml" --stream
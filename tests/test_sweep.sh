@@ -0,0 +1,21 @@
+# many LPs from one parse with --budgets (user-020)
+
+# each file is the LP a single run writes for its budget
+mkdir -p "$WORK/sweep/one" "$WORK/sweep/list" "$WORK/sweep/range"
+for b in 0 10 20.5 35 99; do
+    "$BIN" --app Medium $MEDIUM --budget $b --outdir "$WORK/sweep/one/"
+    mv "$WORK/sweep/one/Medium.lp" "$WORK/sweep/one/Medium_$b.lp"
+done
+"$BIN" --app Medium $MEDIUM --budgets 0,10,20.5,35,99 --threads 3 --outdir "$WORK/sweep/list/"
+"$BIN" --app Medium $MEDIUM --budgets 0:30:10 --outdir "$WORK/sweep/range/"
+for b in 0 10 20.5 35 99; do
+    cmp -s "$WORK/sweep/one/Medium_$b.lp" "$WORK/sweep/list/Medium_$b.lp" || fail "sweep: budget $b of a list differs"
+done
+for b in 0 10 20 30; do
+    [ -f "$WORK/sweep/range/Medium_$b.lp" ] || fail "sweep: budget $b of 0:30:10 not written"
+done
+[ "$(ls "$WORK/sweep/range" | wc -l)" = 4 ] || fail "sweep: 0:30:10 writes $(ls "$WORK/sweep/range" | wc -l) files"
+
+# a bad list writes nothing
+"$BIN" --app Medium $MEDIUM --budgets 10,x --outdir "$WORK/sweep/range/" >/dev/null 2>&1
+[ "$(ls "$WORK/sweep/range" | wc -l)" = 4 ] || fail "sweep: a bad list wrote files"
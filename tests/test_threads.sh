@@ -0,0 +1,11 @@
+# LP sections written on several threads (user-015)
+
+lp_output threads --xml "$ROOT/example_output/Small.xml" --threads 4
+
+# the text does not depend on the number of threads
+mkdir -p "$WORK/threads"
+for n in 1 2 3 8; do
+    "$BIN" --app Medium --desc "$HERE/Medium.desc" --budget 80 --threads $n --outdir "$WORK/threads/"
+    mv "$WORK/threads/Medium.lp" "$WORK/threads/Medium$n.lp"
+    cmp -s "$WORK/threads/Medium1.lp" "$WORK/threads/Medium$n.lp" || fail "threads: $n threads write another LP"
+done
@@ -0,0 +1,3 @@
+# XML input, memory-mapped (user-001)
+
+lp_output xml --xml "$ROOT/example_output/Small.xml"